@@ -0,0 +1,58 @@
+#!/bin/sh
+# Failover time: qnsd logs in on a first mock-netsoul, which is then
+# stopped (SIGSTOP, so the socket stays open but silent), and the time
+# until qnsd is logged in on a second one is printed, in milliseconds.
+#   bench/failover.sh [ping interval] [ping deadline] [runs]
+# Detection takes at most interval + deadline * 5/4, plus one login.
+# MOCK and QNSD point to the binaries, the ones in PATH by default.
+
+MOCK=${MOCK:-mock-netsoul}
+QNSD=${QNSD:-qnsd}
+INTERVAL=${1:-250}
+DEADLINE=${2:-1000}
+RUNS=${3:-5}
+LOG=$(mktemp)
+
+now() { echo $(($(date +%s%N) / 1000000)); }
+
+# Waits for a line matching $1 in the qnsd log, 30 s at most
+wait_for() {
+    i=0
+    while ! grep -q "$1" "$LOG"; do
+        i=$((i + 1))
+        [ $i -gt 3000 ] && return 1
+        sleep 0.01
+    done
+}
+
+run=0
+while [ $run -lt $RUNS ]; do
+    run=$((run + 1))
+    : > "$LOG"
+    "$MOCK" --port 4242 --users 100 > /dev/null 2>&1 &
+    first=$!
+    sleep 0.5
+    # The fallback is down on the first attempt: the session settles on
+    # the first mock, the fallback scoring below it.
+    QNSD_PASSWORD=password "$QNSD" --server 127.0.0.1 --port 4242 \
+        --fallback 127.0.0.1:4243 --login bench_failover \
+        --ping-interval "$INTERVAL" --ping-deadline "$DEADLINE" \
+        > /dev/null 2> "$LOG" &
+    qnsd=$!
+    wait_for "NetSouled" || { echo "run $run: no login" >&2; exit 1; }
+    "$MOCK" --port 4243 --users 100 > /dev/null 2>&1 &
+    second=$!
+    sleep 2
+    start=$(now)
+    kill -STOP $first
+    if wait_for "Failed over"; then
+        echo "run $run: $(($(now) - start)) ms ($(grep "silent" "$LOG"))"
+    else
+        echo "run $run: no failover" >&2
+    fi
+    kill $qnsd $second
+    kill -CONT $first
+    kill $first
+    wait 2> /dev/null
+done
+rm -f "$LOG"
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Epoll load mode against mock-netsoul: n sessions of one login, each
+# watching 100 simulated users, on SHARDS threads (1 by default).
+#   bench/load.sh [sessions] [seconds]
+# Prints one line: sessions logged in, failed, then lines and events
+# parsed per second and the bytes exchanged over the run.
+# MOCK and QNSD point to the binaries, the ones in PATH by default.
+
+MOCK=${MOCK:-mock-netsoul}
+QNSD=${QNSD:-qnsd}
+SESSIONS=${1:-2000}
+DURATION=${2:-30}
+SHARDS=${SHARDS:-1}
+LOG=$(mktemp)
+
+# Two descriptors per session at most, while reconnecting
+ulimit -n $((SESSIONS * 2 + 64)) 2> /dev/null
+
+"$MOCK" --port 4242 --users 1000 --churn 50 --states 200 > /dev/null 2>&1 &
+mock=$!
+sleep 0.5
+QNSD_PASSWORD=password "$QNSD" --server 127.0.0.1 --port 4242 \
+    --login bench_load --sessions "$SESSIONS" --shards "$SHARDS" \
+    --duration "$DURATION" $(seq -f 'user_%g' 0 99) > /dev/null 2> "$LOG"
+kill $mock
+wait 2> /dev/null
+
+# elapsed shards sessions connected netsouled failed closed lines
+# events connection-points in out
+tail -n 1 "$LOG" | awk '{
+    s = $1 / 1000;
+    printf "shards %d: %d/%d logged in, %d failed, %.0f lines/s, %.0f events/s, %d B in, %d B out\n",
+           $2, $5, $3, $6, $8 / s, $9 / s, $11, $12 }'
+rm -f "$LOG"
@@ -0,0 +1,53 @@
+#!/bin/sh
+# Long message throughput: two qnsd logged in with one login at two
+# locations on mock-netsoul, the first one pastes n bytes to the other.
+#   bench/paste.sh [bytes] [qnsd options...]
+# Prints the first qnsd's report (lines, queueing and writing time) and
+# the milliseconds until the second one had the whole message.
+# Flood control sets the pace, e.g. add --flood-rate 65536.
+# MOCK and QNSD point to the binaries, the ones in PATH by default.
+
+MOCK=${MOCK:-mock-netsoul}
+QNSD=${QNSD:-qnsd}
+BYTES=${1:-65536}
+[ $# -gt 0 ] && shift
+OUT=$(mktemp)
+ERR=$(mktemp)
+LOG=$(mktemp)
+
+now() { echo $(($(date +%s%N) / 1000000)); }
+
+# Waits for a line matching $2 in file $1, 10 minutes at most
+wait_for() {
+    i=0
+    while ! grep -q "$2" "$1"; do
+        i=$((i + 1))
+        [ $i -gt 60000 ] && return 1
+        sleep 0.01
+    done
+}
+
+"$MOCK" --port 4242 --users 0 > /dev/null 2>&1 &
+mock=$!
+sleep 0.5
+QNSD_PASSWORD=password "$QNSD" --server 127.0.0.1 --port 4242 \
+    --login bench_paste --location receiver "$@" > "$OUT" 2> "$ERR" &
+receiver=$!
+wait_for "$ERR" "NetSouled" || { echo "receiver: no login" >&2; exit 1; }
+QNSD_PASSWORD=password "$QNSD" --server 127.0.0.1 --port 4242 \
+    --login bench_paste --location sender --paste "$BYTES" "$@" \
+    > /dev/null 2> "$LOG" &
+sender=$!
+wait_for "$LOG" "^paste: .* queued" || { echo "sender: no paste" >&2; exit 1; }
+start=$(now)
+if wait_for "$OUT" "^msg "; then
+    received=$(($(now) - start))
+    wait_for "$LOG" "^paste: written"
+    grep "^paste:" "$LOG"
+    echo "paste: received in $received ms"
+else
+    echo "paste: not received" >&2
+fi
+kill $sender $receiver $mock
+wait 2> /dev/null
+rm -f "$OUT" "$ERR" "$LOG"
@@ -0,0 +1,29 @@
+#!/bin/sh
+# Parsing cost on recorded traffic: captures s seconds of a qnsd
+# session watching 500 busy simulated users on mock-netsoul, then
+# replays the capture as fast as possible.
+#   bench/replay.sh [seconds] [capture]
+# Prints the replay report: lines/s, parsing time and field allocations
+# per line with and without the batch field table. The capture is kept
+# when a path is given, e.g. for qnsd --tokenizer-bench.
+# MOCK and QNSD point to the binaries, the ones in PATH by default.
+
+MOCK=${MOCK:-mock-netsoul}
+QNSD=${QNSD:-qnsd}
+DURATION=${1:-30}
+CAPTURE=${2:-$(mktemp)}
+
+"$MOCK" --port 4242 --users 2000 --churn 100 --states 500 --messages 20 \
+    > /dev/null 2>&1 &
+mock=$!
+sleep 0.5
+QNSD_PASSWORD=password "$QNSD" --server 127.0.0.1 --port 4242 \
+    --login bench_replay --capture "$CAPTURE" \
+    $(seq -f 'user_%g' 0 499) > /dev/null 2>&1 &
+qnsd=$!
+sleep "$DURATION"
+kill $qnsd $mock
+wait 2> /dev/null
+
+"$QNSD" --replay "$CAPTURE" --speed 0 2>&1 > /dev/null | tail -n 1
+[ $# -lt 2 ] && rm -f "$CAPTURE"
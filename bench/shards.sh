@@ -0,0 +1,8 @@
+#!/bin/sh
+# Shard scaling: bench/load.sh once per shard count.
+#   bench/shards.sh [sessions] [seconds]
+# SHARD_COUNTS lists the counts to run, "1 2 4 8" by default.
+
+for k in ${SHARD_COUNTS:-1 2 4 8}; do
+    SHARDS=$k "$(dirname "$0")/load.sh" "$@"
+done
@@ -0,0 +1,59 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <QtGlobal>
+#include <QVarLengthArray>
+
+// Bump allocator for data that lives as long as one parsed batch:
+// allocate() slices big blocks, reset() gives everything back at once
+// and keeps the first block for the next batch. Nothing is destroyed,
+// only store plain data in it. Not thread safe.
+class   Arena
+{
+ public:
+  Arena(const int blockSize = 16384);
+  ~Arena(void);
+
+  // size bytes, suitably aligned for any type, never NULL
+  void* allocate(const int size);
+  char* copy(const char* data, const int size);
+  void  reset(void);
+
+  // Since the last reset
+  int   allocations(void) const { return this->_allocations; }
+  int   used(void) const { return this->_used; }
+  // Blocks taken from the heap since construction
+  quint64 blocksAllocated(void) const { return this->_blocksAllocated; }
+
+ private:
+  Q_DISABLE_COPY(Arena)
+  void  grow(const int size);
+
+ private:
+  QVarLengthArray<char*, 8> _blocks;
+  int                       _blockSize;
+  char*                     _current; // next free byte
+  char*                     _limit;   // end of the current block
+  int                       _allocations;
+  int                       _used;
+  quint64                   _blocksAllocated;
+};
+
+#endif // ARENA_H_
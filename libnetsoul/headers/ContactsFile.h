@@ -0,0 +1,49 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CONTACTS_FILE_H_
+#define CONTACTS_FILE_H_
+
+#include <QString>
+#include <QStringList>
+
+class   QIODevice;
+
+// Headless access to contacts.qns files (qns version 1.0): the logins
+// of every contact, groups flattened, and the blocked logins.
+// ContactsReader/ContactsWriter remain the way the GUI loads its tree.
+class   ContactsFile
+{
+ public:
+  ContactsFile(void);
+
+  bool  read(QIODevice* device);
+  bool  write(QIODevice* device) const;
+  const QString&     errorString(void) const { return this->_error; }
+
+  const QStringList& logins(void) const { return this->_logins; }
+  const QStringList& blocked(void) const { return this->_blocked; }
+  void  setLogins(const QStringList& logins) { this->_logins = logins; }
+  void  setBlocked(const QStringList& blocked) { this->_blocked = blocked; }
+
+ private:
+  QStringList _logins;
+  QStringList _blocked;
+  QString     _error;
+};
+
+#endif // CONTACTS_FILE_H_
@@ -0,0 +1,129 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EPOLL_ENGINE_H_
+#define EPOLL_ENGINE_H_
+
+#include <QHash>
+#include <QVector>
+#include <QByteArray>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "Protocol.h"
+#include "TimerWheel.h"
+#include "SessionOptions.h"
+
+// Linux only alternative to Network for holding thousands of sessions
+// in one thread: non-blocking sockets on an edge-triggered epoll, one
+// LineBuffer framed in place per connection, and every ping or
+// reconnection timer on a single TimerWheel. No QObject per session.
+// Lines go through the same Protocol as Network, the login sequence is
+// the same too.
+class   EpollEngine
+{
+ public:
+  // Receives whatever is not part of the handshake
+  class Listener
+  {
+  public:
+    virtual ~Listener(void) {}
+    virtual void sessionEvent(const int session,
+                              const NetsoulEvent& event) = 0;
+  };
+
+  struct Stats
+  {
+    Stats(void) : connected(0), netsouled(0), failed(0), closed(0),
+                  lines(0), bytesIn(0), bytesOut(0) {}
+    int     connected;
+    int     netsouled;
+    int     failed;  // authentication failures
+    int     closed;  // connections lost or refused
+    quint64 lines;
+    quint64 bytesIn;
+    quint64 bytesOut;
+  };
+
+  EpollEngine(void);
+  ~EpollEngine(void);
+
+  bool  init(void);
+  void  setListener(Listener* listener) { this->_listener = listener; }
+  // watch_log_user and who sent by every session once logged in
+  void  setContacts(const QStringList& logins);
+  int   addSession(const SessionOptions& options);
+  int   sessionCount(void) const { return this->_sessions.size(); }
+  void  connectAll(void);
+  int   runOnce(const int timeout);
+  void  stop(void) { this->_running = false; }
+  void  run(void);
+  const Stats& stats(void) const { return this->_stats; }
+  qint64 elapsed(void) const { return this->_clock.elapsed(); }
+
+ private:
+  enum Status { Idle, Connecting, Connected };
+  enum TimerKind { PingTimer, ReconnectTimer };
+  struct Login
+  {
+    QByteArray address; // sockaddr_in
+    QByteArray name;
+    QByteArray password;
+    QByteArray location; // empty: resolved per connection
+    QByteArray comment;
+    QString    rawLocation;
+  };
+  struct Session
+  {
+    Session(void) : fd(-1), status(Idle), generation(0), retries(0),
+                    login(-1), written(0) {}
+    int        fd;
+    Status     status;
+    quint32    generation;
+    int        retries;
+    int        login; // index in _logins
+    Protocol   protocol;
+    QByteArray out;
+    int        written; // bytes of out already sent
+  };
+
+  void  connectSession(const int id);
+  void  closeSession(const int id, const bool reconnect);
+  void  handleReadable(const int id);
+  void  handleWritable(const int id);
+  void  handleEvent(const int id, const NetsoulEvent& event);
+  void  send(const int id, const QByteArray& data);
+  void  flush(const int id);
+  void  fireTimers(void);
+  QByteArray resolveLocation(const int fd, const Login& login) const;
+
+ private:
+  int                 _epoll;
+  bool                _running;
+  Listener*           _listener;
+  QVector<Session*>   _sessions;
+  QVector<Login>      _logins;
+  QHash<QString, QByteArray> _addresses; // resolved "host:port"
+  QByteArray          _presenceCommands;
+  TimerWheel          _wheel;
+  QElapsedTimer       _clock;
+  Stats               _stats;
+  QList<NetsoulEvent> _events;
+  QByteArray          _replies;
+  QVector<TimerWheel::Timer> _expired;
+};
+
+#endif // EPOLL_ENGINE_H_
@@ -0,0 +1,72 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FIELD_TABLE_H_
+#define FIELD_TABLE_H_
+
+#include <QString>
+#include <QVarLengthArray>
+#include "Arena.h"
+
+// Fields decoded while parsing one batch of lines. A who sweep or a
+// burst of state changes repeats the same logins, promos and locations:
+// each one is decoded and allocated once per batch, later lines share
+// its QString. Raw bytes, the lookup table and decoding scratch live in
+// an Arena, released all together by clear() once the batch is parsed.
+// The QStrings handed out do not depend on it.
+class   FieldTable
+{
+ public:
+  FieldTable(void);
+
+  QString field(const char* data, const int size);
+  // url encoded field (location, comment)
+  QString encodedField(const char* data, const int size);
+  // url encoded text seen once (a message): decoded, never shared
+  QString encodedText(const char* data, const int size);
+  void    clear(void);
+
+  // Heap allocations made for fields since construction, and how many
+  // more url_decode() and a QString per field would have made
+  quint64 allocations(void) const
+    { return this->_allocations + this->_arena.blocksAllocated(); }
+  quint64 saved(void) const { return this->_saved; }
+
+ private:
+  struct Entry
+  {
+    uint        hash;
+    bool        encoded;
+    int         size;
+    const char* data;
+    int         value; // index in _values
+  };
+
+  QString lookup(const char* data, const int size, const bool encoded);
+  QString decode(const char* data, const int size);
+  void    rehash(const int capacity);
+
+ private:
+  Arena                        _arena;
+  Entry**                      _slots;
+  int                          _capacity; // power of two
+  QVarLengthArray<QString, 64> _values;
+  quint64                      _allocations;
+  quint64                      _saved;
+};
+
+#endif // FIELD_TABLE_H_
@@ -0,0 +1,65 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FRAGMENTER_H_
+#define FRAGMENTER_H_
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+// Messages too long for one server line are sent as several, each
+// prefixed with "[#id k/n] " so that plain clients still show readable
+// pieces. Cuts never split an escape or a UTF-8 sequence and prefer a
+// line break ("<br />" as Chat sends it, or a newline), then a space,
+// near the end of the piece.
+class   Fragmenter
+{
+ public:
+  // url-encoded payloads of at most budget bytes, tagged when more
+  // than one is needed
+  static QList<QByteArray> split(const QString& message, const int id,
+                                 const int budget);
+
+  // text is a received message from sender. False while it is a
+  // fragment of an unfinished message, otherwise message is the
+  // whole text.
+  bool  reassemble(const QString& sender, const QString& text,
+                   QString& message);
+  int   pending(void) const { return this->_pending.size(); }
+
+ private:
+  struct Pending
+  {
+    QVector<QString> parts;
+    int              received;
+    QElapsedTimer    updated; // last fragment received
+  };
+
+  static int  tagSize(const int id, const int digits);
+  static bool parseTag(const QString& text, int& id, int& index,
+                       int& count, int& length);
+  void  expire(void);
+
+ private:
+  QHash<QString, Pending> _pending;
+};
+
+#endif // FRAGMENTER_H_
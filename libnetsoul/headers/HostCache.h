@@ -0,0 +1,46 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HOST_CACHE_H_
+#define HOST_CACHE_H_
+
+#include <QHash>
+#include <QString>
+#include <QElapsedTimer>
+
+// Address a host name last connected to, so that reconnections skip
+// the resolver. An entry expires after a while, or as soon as a
+// connection to it fails; the name is then resolved again.
+class   HostCache
+{
+ public:
+  // The cached address, or host itself when there is none
+  QString lookup(const QString& host) const;
+  void    store(const QString& host, const QString& address);
+  void    forget(const QString& host) { this->_entries.remove(host); }
+
+ private:
+  struct Entry
+  {
+    QString       address;
+    QElapsedTimer stored;
+  };
+
+  QHash<QString, Entry> _entries;
+};
+
+#endif // HOST_CACHE_H_
@@ -0,0 +1,58 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <QVector>
+#include <QJsonObject>
+
+// HDR-style histogram of durations in microseconds: 16 linear
+// sub-buckets per power of two, so any value is known within 1/16
+// (about 6%) from 1 us to hours, in a few kilobytes and with O(1)
+// recording.
+class   LatencyHistogram
+{
+ public:
+  LatencyHistogram(void);
+
+  void    record(const qint64 micros);
+  void    reset(void);
+  quint64 count(void) const { return this->_count; }
+  qint64  last(void) const { return this->_last; }
+  qint64  min(void) const { return this->_min; }
+  qint64  max(void) const { return this->_max; }
+  qint64  mean(void) const;
+  // Value under which p percent of the samples fall, -1 if empty
+  qint64  percentile(const double p) const;
+  // Summary, percentiles and the non-empty buckets
+  QJsonObject toJson(void) const;
+
+ private:
+  static int    bucketOf(const quint64 value);
+  static qint64 highestOf(const int bucket);
+
+ private:
+  QVector<quint64> _buckets;
+  quint64          _count;
+  double           _sum;
+  qint64           _last;
+  qint64           _min;
+  qint64           _max;
+};
+
+#endif // LATENCY_HISTOGRAM_H_
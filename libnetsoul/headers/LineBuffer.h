@@ -0,0 +1,64 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LINE_BUFFER_H_
+#define LINE_BUFFER_H_
+
+#include <QByteArray>
+
+class   QIODevice;
+
+// Growable receive buffer used to frame NetSoul lines.
+// Bytes are read straight from the device into the buffer and lines are
+// handed out as views on it: nothing is copied nor converted until the
+// caller really needs it.
+// Views returned by nextLine() are only valid until the next call to
+// readFrom(), append() or compact().
+class   LineBuffer
+{
+ public:
+  LineBuffer(void);
+
+  qint64 readFrom(QIODevice* device);
+#ifdef Q_OS_UNIX
+  qint64 readFrom(const int fd, bool& closed);
+#endif
+  void   append(const char* data, const int size);
+  bool   nextLine(QByteArray& line);
+  void   compact(void);
+  void   clear(void);
+  int    pending(void) const { return this->_end - this->_begin; }
+  // Copy of the bytes not handed out yet
+  QByteArray unread(void) const
+    { return QByteArray(this->_buffer.constData() + this->_begin,
+                        pending()); }
+  // View on the last size bytes received
+  QByteArray received(const int size) const
+    { return QByteArray::fromRawData(this->_buffer.constData() + this->_end
+                                     - size, size); }
+
+ private:
+  void   reserve(const int size);
+
+ private:
+  QByteArray _buffer;
+  int        _begin; // first unread byte
+  int        _end;   // one past the last received byte
+  int        _scan;  // where the next '\n' lookup starts
+};
+
+#endif // LINE_BUFFER_H_
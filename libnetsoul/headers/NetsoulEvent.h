@@ -0,0 +1,70 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NETSOUL_EVENT_H_
+#define NETSOUL_EVENT_H_
+
+#include <QString>
+#include <QMetaType>
+#include <QStringList>
+#include <QByteArray>
+
+class   Tokenizer;
+class   FieldTable;
+class   QDataStream;
+
+// Parsed presence of one connection point, as carried by the
+// msg, state and who signals of Network.
+// type tells which line produced it, step/args are only used by the
+// handshake, message by msg and typing by typing notifications.
+// RepEvent is a "rep 002" received once logged in, it carries nothing.
+struct  NetsoulEvent
+{
+  enum Type { HandShakingEvent, MsgEvent, StateEvent,
+              WhoEvent, WhoEndEvent, TypingEvent, RepEvent };
+  // Values match the indexes of states[] (tools.cpp)
+  enum State { Connection, Logout, Actif, Away, Idle, Lock, Server, Unknown };
+
+  NetsoulEvent(void)
+    : type(StateEvent), id(-1), state(Unknown), step(0), typing(false) {}
+
+  bool  parseConnectionInfo(const Tokenizer& tokens, const int field,
+                              FieldTable& fields);
+  static State toState(const QByteArray& name);
+
+  Type    type;
+  int     id;
+  State   state;
+  QString login;
+  QString ip;
+  QString promo;
+  QString location;
+  QString comment;
+  int     step;
+  bool    typing;
+  QString message;
+  QStringList args;
+};
+
+// Presence fields only (id, state, login, ip, promo, location and
+// comment): the snapshot handed over with a session.
+QDataStream&    operator<<(QDataStream& out, const NetsoulEvent& event);
+QDataStream&    operator>>(QDataStream& in, NetsoulEvent& event);
+
+Q_DECLARE_METATYPE(NetsoulEvent)
+
+#endif // NETSOUL_EVENT_H_
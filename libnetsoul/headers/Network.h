@@ -0,0 +1,228 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <QTimer>
+#include <QQueue>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QStringList>
+#include "HostCache.h"
+#include "Fragmenter.h"
+#include "Outbox.h"
+#include "NetsoulEvent.h"
+#include "LatencyHistogram.h"
+#include "TokenBucket.h"
+#include "TypingShaper.h"
+#include "OutboundQueue.h"
+#include "SessionOptions.h"
+
+class   NetworkWorker;
+
+// One NetSoul session: logs in with its own SessionOptions, keeps the
+// connection alive and reconnects by itself.
+// Socket and parser run on a dedicated I/O thread (NetworkWorker),
+// Network stays on the GUI thread and re-emits the parsed events.
+// The server and its fallbacks are ranked by a health score; the best
+// ones are tried in parallel on each connection, and a server that
+// stops answering pings is left for the next one.
+class   Network : public QObject
+{
+  Q_OBJECT
+
+    public:
+  // Login sequence milestones, timed from connect()
+  enum LoginPhase { TcpConnect, SalutReceived, Authenticated, FirstWho,
+                    LoginPhaseCount };
+
+  Network(QObject* parent = NULL);
+  virtual ~Network(void);
+
+  void  setSessionOptions(const SessionOptions& options);
+  const SessionOptions& sessionOptions(void) const { return this->_options; }
+  QAbstractSocket::SocketState state(void) const;
+  void  sendMessage(const char* msg) { sendMessage(QByteArray(msg)); }
+  void  sendMessage(const QByteArray& msg);
+  // Commands waiting for the token bucket or the socket to drain
+  int   queueDepth(void) const { return this->_outbound.size(); }
+  // Milliseconds from connect() to phase, -1 if not reached yet
+  qint64 loginPhase(const LoginPhase phase) const
+    { return this->_loginPhases[phase]; }
+  // Round trips of our pings, in microseconds
+  const LatencyHistogram& pingLatency(void) const
+    { return this->_pingLatency; }
+  // Milliseconds since the server last sent anything, -1 if never:
+  // a large value with pings answered quickly means the client stalls.
+  qint64 inboundAge(void) const;
+  // Login phases, queue, inbound age, ping histogram and typing
+  // notifications
+  QJsonObject statistics(void) const;
+
+  void  connect(void);
+  void  disconnect(void);
+  // Session handoff (SessionHandoff.h), Linux only. detach() leaves a
+  // logged in session without ending it: returns its descriptor, -1 if
+  // there is none, and what resume() needs in session. resume() goes
+  // on with it, logged in, with neither handshake nor who sweep; fd is
+  // still the caller's if it returns false.
+  int   detach(QByteArray& session);
+  bool  resume(const int fd, const QByteArray& session);
+  void  resolveLocation(QString& oldLocation) const;
+
+  void  refreshContact(const QString& contact);
+  void  refreshContacts(const QStringList& contacts);
+  // status false: typing, true: cancelled. Shaped, see TypingShaper.
+  void  transmitTypingStatus(const QString&, const QString&, const bool);
+  const TypingShaper& typingShaper(void) const { return this->_typing; }
+  // Messages go through the outbox: kept until the socket takes them,
+  // sent once logged in. Both return an id for messageSent(), the
+  // message is sent when isPending() turns false.
+  // Sent in several lines when too long, see Fragmenter
+  qint64 transmitMsg(const QString&, const QString& loc, const QString& msg);
+  // Encoded once, sent as msg_user brace lists of at most chunkBudget
+  // bytes of logins
+  qint64 transmitGroupMsg(const QStringList& logins, const QString& msg);
+  bool  isPending(const qint64 id) const
+    { return this->_outbox.isPending(id); }
+  void  monitorContact(const QString& contact);
+  void  monitorContacts(const QStringList& contacts);
+  // Handled as if just received, see TraceReplayer
+  void  dispatchEvents(const QList<NetsoulEvent>& events);
+
+  public slots:
+  void  sendStatus(const int& status);
+  void  reconnect(void);
+
+ signals:
+  void  handShaking(int step, QStringList);
+  void  msg(const NetsoulEvent&, const QString&);
+  void  state(const NetsoulEvent&);
+  void  who(const NetsoulEvent&);
+  void  typingStatus(const int id, bool typing);
+  // A who chunk got its reply, latency in milliseconds
+  void  whoChunkAnswered(int logins, qint64 latency);
+  // Every chunk of the current who sweep got its reply
+  void  sweepFinished(int chunks, int logins, qint64 duration);
+  void  loginPhaseReached(int phase, qint64 elapsed);
+  // A ping got its reply, round trip in microseconds
+  void  pingAnswered(qint64 rtt);
+  // The socket took the message transmitMsg() or transmitGroupMsg()
+  // returned id for
+  void  messageSent(qint64 id);
+  void  statusMessage(const QString& message, int timeout);
+  // Emitted before an automatic reconnection
+  void  reconnecting(void);
+  // Emitted when automatic reconnection stops retrying
+  void  reconnectionAbandoned(void);
+  void  stateChanged(const QAbstractSocket::SocketState&);
+
+  private slots:
+  void  handleSocketState(QAbstractSocket::SocketState state,
+                          const QString& localAddress);
+  void  handleSocketError(const QString& message);
+  void  drainEvents(void);
+  void  flush(void);
+  void  flushTyping(void);
+  void  ping(void);
+  void  checkLiveness(void);
+  void  handleEndpointConnected(int attempt, const QString& address);
+  void  handleEndpointFailed(int attempt);
+  void  acknowledgeMessages(qint64 written);
+
+ private:
+  void  dispatch(const NetsoulEvent& event);
+  void  handleWhoEnd(void);
+  void  handleRep(void);
+  bool  isQuiet(const qint64 now) const;
+  bool  isPingWaiting(void) const;
+  void  handleDeadPeer(void);
+  void  adjustScore(const int attempt, const int delta);
+  void  reachLoginPhase(const LoginPhase phase);
+  void  prepareLogin(void);
+  void  processHandShaking(const NetsoulEvent& event);
+  void  scheduleFlush(const int msecs = 0);
+  void  openOutbox(void);
+  qint64 queueMessage(const QByteArray& command);
+
+ private:
+  SessionOptions _options;
+  struct Endpoint
+  {
+    QString host;
+    quint16 port;
+    int     score; // health, raised on success, lowered on failure
+  };
+  QList<Endpoint> _endpoints; // server then fallbacks
+  QList<int>     _attempts;   // endpoint of each parallel attempt
+  int            _endpoint;   // the one connected to, -1 if none
+  HostCache      _hosts;
+  QTimer         _livenessTimer;
+  bool           _reconnectWhenClosed;
+  bool           _resuming;   // a handed over session, until connected
+  QElapsedTimer  _failover;   // since a dead server was detected
+  QThread        _thread;
+  NetworkWorker* _worker;
+  OutboundQueue  _outbound;
+  TokenBucket    _bucket;
+  QTimer         _flushTimer;
+  TypingShaper   _typing;
+  QTimer         _typingTimer;
+  Fragmenter     _fragments;  // received messages being reassembled
+  int            _messageId;  // of the next fragmented message
+  Outbox         _outbox;
+  bool           _outboxOpen; // logged in, messages go to _outbound
+  // Messages handed to the socket with the byte count it will have
+  // written once they are out, in order
+  QQueue<QPair<qint64, qint64> > _messagesInFlight;
+  qint64         _bytesSent;  // to the socket since it connected
+  struct WhoChunk
+  {
+    int           logins;
+    QElapsedTimer sent;
+  };
+  QQueue<WhoChunk> _whoInFlight; // in send order, replies come in order
+  int            _maxWhoInFlight;
+  QElapsedTimer  _sweep;
+  int            _sweepChunks;
+  int            _sweepLogins;
+  QElapsedTimer  _loginClock;
+  qint64         _loginPhases[LoginPhaseCount];
+  // See handleRep(), _clock nanoseconds
+  qint64         _pingSent;    // the timed ping, -1 if none
+  qint64         _lastCommand; // last write but a timed ping, -1 if none
+  qint64         _pingWaiting; // oldest ping written since inbound
+  int            _pingsQueued; // pings not written yet
+  QElapsedTimer  _clock;
+  LatencyHistogram _pingLatency;
+  QHostAddress   _localAddress;
+  int            _retries;
+  QTimer         _reconnectionTimer;
+  QTimer         _pingTimer;
+  // ext_user_log fields, prepared before connecting
+  QByteArray     _loginName;
+  QByteArray     _loginPassword;
+  QByteArray     _loginLocation;
+  QByteArray     _loginComment;
+  bool           _resolveLocation;
+};
+
+#endif // NETWORK_H
@@ -0,0 +1,125 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NETWORK_WORKER_H_
+#define NETWORK_WORKER_H_
+
+#include <QHash>
+#include <QPair>
+#include <QQueue>
+#include <QList>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+#include "Trace.h"
+#include "Protocol.h"
+#include "SpscQueue.hpp"
+#include "NetsoulEvent.h"
+
+// Lives on Network's I/O thread: owns the socket, frames and parses
+// what it receives and answers pings without involving the GUI.
+// Parsed events are handed over through a lock-free queue, eventsReady()
+// is only emitted when the GUI has drained the previous batch.
+// Connections are attempted to several endpoints at once, the first
+// one to connect becomes the socket and the others are dropped.
+class   NetworkWorker : public QObject
+{
+  Q_OBJECT
+
+    public:
+  NetworkWorker(void);
+
+  // GUI thread side
+  bool  nextEvent(NetsoulEvent& event) { return this->_events.pop(event); }
+  void  acknowledgeEvents(void) { this->_notified.fetchAndStoreOrdered(0); }
+  QAbstractSocket::SocketState socketState(void) const;
+  int   bytesToWrite(void) const { return this->_bytesToWrite.loadAcquire(); }
+  // Milliseconds since the last byte was received, -1 if none yet
+  qint64 msecsSinceLastInbound(void) const;
+  // Milliseconds since a server ping was last answered, -1 if none yet
+  qint64 msecsSinceLastReply(void) const;
+  // Session descriptor left by detach(), -1 if none; the caller
+  // closes it once handed over
+  int   detachedDescriptor(void) const { return this->_detached; }
+
+  public slots:
+  void  setCapture(const QString& path);
+  // "host port" entries, host may be an address
+  void  connectToEndpoints(const QStringList& endpoints);
+  void  disconnectFromHost(void);
+  // Drops the connection at once, pending writes included
+  void  abort(void);
+  void  write(const QByteArray& data);
+  void  close(void);
+  // Session handoff (SessionHandoff.h), Linux only: detach() gives the
+  // connected session up and returns the bytes received but not parsed
+  // yet, resume() takes over one from another process.
+  QByteArray detach(void);
+  void  resume(int fd, const QByteArray& unread);
+
+ signals:
+  void  eventsReady(void);
+  void  stateChanged(QAbstractSocket::SocketState, const QString& localAddress);
+  void  socketError(const QString& message);
+  // index in the connectToEndpoints() list
+  void  endpointConnected(int index, const QString& address);
+  void  endpointFailed(int index);
+  // Bytes of write() calls the socket wrote since it connected; the
+  // ping replies the worker writes by itself are left out
+  void  bytesWritten(qint64 total);
+
+  private slots:
+  void  processPackets(void);
+  void  updateBytesToWrite(void);
+  void  countBytesWritten(qint64 bytes);
+  void  handleSocketState(QAbstractSocket::SocketState state);
+  void  handleSocketError(QAbstractSocket::SocketError error);
+  void  attemptConnected(void);
+  void  attemptFailed(QAbstractSocket::SocketError error);
+
+ private:
+  QTcpSocket* createSocket(void);
+  void  adopt(QTcpSocket* socket);
+  void  abortAttempts(void);
+  void  parseBuffered(void);
+
+ private:
+  QTcpSocket*               _socket;
+  QHash<QTcpSocket*, int>   _attempts; // endpoint index by socket
+  Protocol                  _protocol;
+  SpscQueue<NetsoulEvent>   _events;
+  QAtomicInt                _notified;
+  QAtomicInt                _socketState;
+  QAtomicInt                _bytesToWrite;
+  qint64                    _bytesWritten; // by the socket, replies too
+  qint64                    _bytesQueued;  // given to the socket
+  qint64                    _replyBytes;   // replies written so far
+  QQueue<QPair<qint64, int> > _replyOffsets; // unwritten: start, size
+  QElapsedTimer             _clock;
+  // _clock milliseconds, -1: none yet. 64 bits: an int wraps after
+  // 24.8 days of uptime.
+  QAtomicInteger<qint64>    _lastInbound;
+  QAtomicInteger<qint64>    _lastReply;
+  QList<NetsoulEvent>       _batch;
+  QByteArray                _replies;
+  TraceWriter               _trace;
+  int                       _detached;
+  int                       _silent; // end of the pair left in its place
+};
+
+#endif // NETWORK_WORKER_H_
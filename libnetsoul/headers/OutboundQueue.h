@@ -0,0 +1,100 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OUTBOUND_QUEUE_H_
+#define OUTBOUND_QUEUE_H_
+
+#include <QSet>
+#include <QList>
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+
+// Commands waiting to be written to the server, by priority class.
+// Within a class raw commands keep their order, who and watch_log_user
+// targets are merged (duplicates dropped) where the first one was queued
+// and sent as brace-list commands of at most chunkBudget bytes.
+// The number of who chunks per take() is bounded so their replies can
+// be matched in order.
+// Once logged in the server ends a who with "| who rep 002 -- cmd end"
+// and answers each watch_log_user, msg_user and ping line (ours and
+// the answers to its own) with "rep 002 -- cmd end", but not state.
+// Only who replies are matched against what take() returned; pings are
+// timed without relying on the rest, see Network::handleRep().
+// A keyed command replaces the pending one with the same key, so only
+// the latest typing or state notification for a target is sent.
+// A tagged command reports its tag when it is taken.
+class   OutboundQueue
+{
+ public:
+  // Highest priority first
+  enum Priority { Critical, Message, Presence, Typing, PriorityCount };
+
+  OutboundQueue(void);
+
+  bool  isEmpty(void) const { return 0 == this->_size; }
+  int   size(void) const { return this->_size; }
+  int   size(const Priority priority) const
+    { return this->_entries[priority].size(); }
+  int   pendingWho(void) const { return this->_who.logins.size(); }
+  void  setChunkBudget(const int bytes) { this->_chunkBudget = bytes; }
+
+  void  append(const QByteArray& command,
+               const Priority priority = Critical,
+               const QString& key = QString(),
+               const qint64 tag = -1);
+  void  appendWho(const QString& login);
+  void  appendWho(const QStringList& logins);
+  void  appendWatch(const QString& login);
+  void  appendWatch(const QStringList& logins);
+  QByteArray take(const int budget, const int whoSlots = -1,
+                  QList<int>* whoChunks = NULL, QList<qint64>* tags = NULL,
+                  int* spent = NULL);
+  void  clear(void);
+
+ private:
+  enum Kind { Raw, Who, Watch };
+  struct Entry
+  {
+    Kind       kind;
+    QByteArray command;
+    QString    key;
+    qint64     tag;
+  };
+  struct Targets
+  {
+    Targets(void) : queued(false) {}
+    bool          queued; // is an entry pending in Presence ?
+    QStringList   logins;
+    QSet<QString> seen;
+  };
+
+  void  appendTarget(const Kind kind, Targets& targets, const QString& login);
+  int   takeChunks(QByteArray& out, const char* command, Targets& targets,
+                   const int maxChunks, const int budget, QList<int>* chunks);
+  static void appendBraceList(QByteArray& out, const char* command,
+                              const QStringList& logins);
+
+ private:
+  QList<Entry> _entries[PriorityCount];
+  int          _size;
+  int          _chunkBudget;
+  Targets      _who;
+  Targets      _watch;
+};
+
+#endif // OUTBOUND_QUEUE_H_
@@ -0,0 +1,76 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OUTBOX_H_
+#define OUTBOX_H_
+
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+// Messages not accepted by the socket yet, in sending order.
+// With a journal each message is written to an append-only file before
+// it is queued, then acknowledged once the socket took it, so messages
+// typed while disconnected survive a reconnection or a restart.
+// Messages are synced to disk (fsync, _commit on Windows) before
+// append() returns, so they also survive an OS crash or a power loss.
+// Acknowledgements are only flushed: one lost with the machine makes
+// its message sent again.
+// Journal layout: the 8 bytes magic "NSOUTBX1", then one record per
+// message or acknowledgement:
+//   byte    'M' or 'A'
+//   varint  sequence number
+//   varint  command size, bytes  command line ('M' only)
+// varints as in Trace.h. A torn last record is ignored. The journal is
+// rewritten with the pending messages on open and emptied whenever
+// nothing is pending.
+class   Outbox
+{
+ public:
+  struct Message
+  {
+    qint64     seq;
+    QByteArray command;
+  };
+
+  Outbox(void) : _next(1) {}
+
+  // Loads the pending messages of path and journals there from now
+  // on. An empty path keeps them in memory only.
+  bool  open(const QString& path);
+  QString errorString(void) const { return this->_error; }
+  // Sequence number of the new message
+  qint64 append(const QByteArray& command);
+  void  acknowledge(const qint64 seq);
+  const QList<Message>& pending(void) const { return this->_pending; }
+  bool  isPending(const qint64 seq) const;
+
+ private:
+  bool  load(void);
+  void  rewrite(void);
+  void  writeRecord(const char type, const Message& message);
+  void  sync(void);
+
+ private:
+  QFile          _file;
+  QList<Message> _pending;
+  QString        _error;
+  qint64         _next;
+};
+
+#endif // OUTBOX_H_
@@ -0,0 +1,73 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PRESENCE_SCHEDULER_H_
+#define PRESENCE_SCHEDULER_H_
+
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "NetsoulEvent.h"
+
+class   Network;
+
+// Keeps presence of a contacts list in sync without sweeping it all:
+// watch_log_user already pushes login, logout and state changes, so
+// only contacts nobody heard of for a while are queried again, plus a
+// small random sample to catch missed events.
+// The interval shrinks when a who reply contradicts what we knew and
+// grows while everything agrees. A full sweep is only done by start().
+class   PresenceScheduler : public QObject
+{
+  Q_OBJECT
+
+    public:
+  PresenceScheduler(Network* network);
+
+  // Logins to keep in sync, read on each tick
+  void  setContacts(const QStringList& logins) { this->_contacts = logins; }
+  void  start(void);
+  // Goes on from known presence instead of sweeping, after a handoff
+  void  resume(const QList<NetsoulEvent>& snapshot);
+  void  stop(void);
+
+  private slots:
+  void  tick(void);
+  void  checkWho(const NetsoulEvent& event);
+  void  checkState(const NetsoulEvent& event);
+  void  checkMsg(const NetsoulEvent& event, const QString&);
+  void  sweepFinished(void);
+
+ private:
+  void  touch(const QString& login);
+
+ private:
+  Network*               _network;
+  QStringList            _contacts;
+  QTimer                 _timer;
+  QElapsedTimer          _clock;
+  QHash<QString, qint64> _checked; // last query or event, per login
+  QHash<int, int>        _states;  // last known state, per connection id
+  int                    _interval;
+  bool                   _drift;
+  bool                   _baseline; // has the full sweep been answered ?
+};
+
+#endif // PRESENCE_SCHEDULER_H_
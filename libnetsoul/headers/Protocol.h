@@ -0,0 +1,83 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <QList>
+#include <QByteArray>
+#include "Tokenizer.h"
+#include "FieldTable.h"
+#include "LineBuffer.h"
+#include "NetsoulEvent.h"
+
+// NetSoul client side parser: frames the received bytes, follows the
+// handshake and turns each line into a NetsoulEvent.
+// It has no socket and no QObject, so it can run on any thread.
+class   Protocol
+{
+ public:
+  // Handshake steps, as carried by HandShakingEvent
+  enum HandShakingStep { WaitingSalut, WaitingAuthReply,
+                         WaitingLogReply, NetSouled };
+
+  Protocol(void);
+
+  LineBuffer&     buffer(void) { return this->_rbuffer; }
+  HandShakingStep handShakingStep(void) const
+    { return this->_handShakingStep; }
+
+  void  reset(void);
+  // For a session logged in by someone else (SessionHandoff)
+  void  resume(void);
+  int   parseLines(QList<NetsoulEvent>& events, QByteArray& replies);
+  // Allocation counters of the decoded fields
+  const FieldTable& fields(void) const { return this->_fields; }
+
+  // auth_ag and ext_user_log answering salut, ready to be written
+  // together. location and comment are already url encoded.
+  static QByteArray loginCommands(const QStringList& salut,
+                                  const QByteArray& login,
+                                  const QByteArray& password,
+                                  const QByteArray& location,
+                                  const QByteArray& comment);
+
+ private:
+  void  interpretLine(const QByteArray& line);
+  void  handleSalut(const QByteArray& line);
+  void  handleRep(const QByteArray& line);
+  void  handleUserCmd(const QByteArray& line);
+  void  handleWho(const Tokenizer& parts, NetsoulEvent& event);
+  void  handleMsg(const Tokenizer& parts, NetsoulEvent& event);
+  void  handleState(const Tokenizer& parts, NetsoulEvent& event);
+  void  handleLog(const Tokenizer& parts, NetsoulEvent& event);
+  void  handleTyping(const Tokenizer& parts, NetsoulEvent& event);
+  QString field(const Tokenizer& parts, const int i);
+  QString encodedField(const Tokenizer& parts, const int i);
+  void  push(const NetsoulEvent::Type type, NetsoulEvent& event);
+  void  pushHandShaking(const int step, NetsoulEvent event);
+
+ private:
+  QList<NetsoulEvent>* _events;
+  QByteArray*          _replies;
+  LineBuffer           _rbuffer;
+  Tokenizer            _tokenizer;
+  FieldTable           _fields; // cleared after each batch
+  HandShakingStep      _handShakingStep;
+};
+
+#endif // PROTOCOL_H_
@@ -0,0 +1,38 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SESSION_HANDOFF_H_
+#define SESSION_HANDOFF_H_
+
+#include <QByteArray>
+
+// Linux only: hands a connected NetSoul socket over to another process
+// on a connected Unix socket (a QLocalSocket descriptor will do). The
+// descriptor travels as SCM_RIGHTS ancillary data of a 4 bytes big
+// endian payload size, the payload follows. Both calls block, the
+// channel may be non-blocking.
+class   SessionHandoff
+{
+ public:
+  static bool send(const int channel, const int fd,
+                   const QByteArray& payload, const int msecs);
+  // fd is -1 unless it returns true
+  static bool receive(const int channel, int& fd, QByteArray& payload,
+                      const int msecs);
+};
+
+#endif // SESSION_HANDOFF_H_
@@ -0,0 +1,63 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SESSION_OPTIONS_H_
+#define SESSION_OPTIONS_H_
+
+#include <QString>
+#include <QStringList>
+
+// Everything a Network session needs to log in and run on its own.
+struct  SessionOptions
+{
+  SessionOptions(void)
+    : server("ns-server.epita.fr"), port(4242),
+      location("%L"), chunkBudget(1024), whoInFlight(4),
+      floodRate(1024), floodBurst(4096),
+      pingInterval(10000), pingDeadline(30000),
+      typingInterval(1000), typingTimeout(5000) {}
+
+  QString server;
+  quint16 port;
+  QStringList fallbacks; // more "host:port", tried after server:port
+  QString login;
+  QString password;
+  QString location;    // %L is replaced by the resolved location
+  QString comment;     // empty: Tools::defaultComment()
+  int     chunkBudget; // bytes per who/watch_log_user line
+  int     whoInFlight; // who chunks awaiting their reply
+  // Flood control of non-critical commands (TokenBucket), in bytes per
+  // second and bytes. The burst lets a full who window (whoInFlight
+  // chunks of chunkBudget bytes) leave at once; the rate, one full line
+  // per second, is the pace the client has always kept below the
+  // server's flood limit. Critical commands are never held back.
+  int     floodRate;
+  int     floodBurst;
+  QString capture;     // trace of the inbound stream (Trace.h), empty: off
+  QString outbox;      // journal of unsent messages (Outbox.h), empty: none
+  int     pingInterval; // milliseconds
+  // Milliseconds a ping may stay unanswered with nothing received, or
+  // a login may take, before the server is deemed dead. 0: never.
+  int     pingDeadline;
+  // Typing notifications, see TypingShaper. Milliseconds between two
+  // to the same destination, and without keystrokes before cancelling
+  // (0: never).
+  int     typingInterval;
+  int     typingTimeout;
+};
+
+#endif // SESSION_OPTIONS_H_
@@ -0,0 +1,72 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHARDED_RUNTIME_H_
+#define SHARDED_RUNTIME_H_
+
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QObject>
+#include <QStringList>
+#include "EpollEngine.h"
+
+// Spreads sessions over one EpollEngine per thread, typically one per
+// core. A shard owns its sockets, buffers and timers outright; the only
+// thing crossing threads is its presence, pushed on a lock-free queue
+// that the collector drains from the owner's event loop.
+// The collector merges by connection id: every shard watching the same
+// contact sees the same connection points, presenceChanged() is only
+// emitted when a connection point actually changes.
+class   ShardedRuntime : public QObject
+{
+  Q_OBJECT
+
+    public:
+  ShardedRuntime(const int shards, QObject* parent = NULL);
+  ~ShardedRuntime(void);
+
+  int   shardCount(void) const { return this->_shards.size(); }
+  int   sessionCount(void) const;
+  // Must be called before start()
+  void  setContacts(const QStringList& logins);
+  int   addSession(const SessionOptions& options);
+  bool  start(void);
+  void  stop(void);
+
+  // Sum of the last snapshot of every shard
+  EpollEngine::Stats stats(void) const;
+  quint64 events(void) const { return this->_events; }
+  int   connectionPoints(void) const { return this->_presence.size(); }
+
+  public slots:
+  void  collect(void);
+
+ signals:
+  void  presenceChanged(const NetsoulEvent& event);
+
+ private:
+  class Shard;
+
+  QList<Shard*>                      _shards;
+  int                                _next; // round robin
+  QTimer                             _collector;
+  QHash<int, NetsoulEvent::State>    _presence; // by connection id
+  quint64                            _events;
+};
+
+#endif // SHARDED_RUNTIME_H_
@@ -0,0 +1,54 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <QVector>
+
+// Hashed timer wheel shared by many connections: scheduling and expiry
+// cost O(1) per timer, there is no per-timer object nor allocation
+// once the slots have grown.
+// Timers cannot be cancelled: owners tag them with a generation and
+// ignore the ones that fire for an older one.
+class   TimerWheel
+{
+ public:
+  struct Timer
+  {
+    int     owner;
+    int     kind;
+    quint32 generation;
+    int     rounds; // full turns left before expiry
+  };
+
+  TimerWheel(const int tick = 100, const int slots = 512);
+
+  void  start(const qint64 now);
+  void  schedule(const int owner, const int kind,
+                 const quint32 generation, const int delay);
+  void  advance(const qint64 now, QVector<Timer>& expired);
+  int   msecsToNextTick(const qint64 now) const;
+
+ private:
+  QVector<QVector<Timer> > _slots;
+  int    _tick;    // milliseconds per slot
+  int    _current; // slot of the last tick
+  qint64 _next;    // time of the next tick
+};
+
+#endif // TIMER_WHEEL_H_
@@ -0,0 +1,47 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TOKEN_BUCKET_H_
+#define TOKEN_BUCKET_H_
+
+#include <QElapsedTimer>
+
+// Byte based flood control: the bucket refills at rate bytes per second
+// up to capacity. consume() may leave it in debt, the following
+// batches then wait until it is paid back.
+class   TokenBucket
+{
+ public:
+  TokenBucket(const int rate, const int capacity);
+
+  void  setRate(const int rate, const int capacity);
+  int   available(void);
+  void  consume(const int tokens);
+  int   msecsUntilAvailable(void);
+
+ private:
+  void  refill(void);
+
+ private:
+  int           _rate;
+  int           _capacity;
+  double        _tokens;
+  QElapsedTimer _clock;
+  qint64        _refilled; // _clock nanoseconds credited so far
+};
+
+#endif // TOKEN_BUCKET_H_
@@ -0,0 +1,60 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TOKENIZER_H_
+#define TOKENIZER_H_
+
+#include <QByteArray>
+#include <QVarLengthArray>
+
+// Splits a NetSoul line on spaces and records, in the same pass, where
+// the ':' and '@' separators of every field are.
+// The scan uses AVX2 when the CPU has it, SSE2 on other x86 and plain C++
+// elsewhere; the result does not depend on the implementation used.
+// Fields are views on the tokenized line, keep the line alive meanwhile.
+class   Tokenizer
+{
+ public:
+  struct Field
+  {
+    int begin;
+    int end;
+    int firstMark; // index of the first ':' or '@' of this field in marks
+    int markCount;
+  };
+
+  Tokenizer(void);
+
+  int   tokenize(const QByteArray& line);
+  int   size(void) const { return this->_fields.size(); }
+  QByteArray at(const int i) const;
+  const Field& field(const int i) const { return this->_fields.at(i); }
+  // Absolute offsets in the line of the ':' and '@' of field i
+  const int* marks(const int i) const
+    { return this->_marks.constData() + this->_fields.at(i).firstMark; }
+  const char* data(void) const { return this->_line.constData(); }
+
+  static const char* implementation(void);
+
+ private:
+  QByteArray                  _line;
+  QVarLengthArray<int, 64>    _delimiters;
+  QVarLengthArray<int, 64>    _marks;
+  QVarLengthArray<Field, 24>  _fields;
+};
+
+#endif // TOKENIZER_H_
@@ -0,0 +1,70 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <QFile>
+#include <QList>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+// Capture of the raw inbound stream of a session.
+// File layout: the 8 bytes magic "NSTRACE1", then one record per chunk
+// read from the socket:
+//   varint  microseconds since the previous chunk (monotonic clock)
+//   varint  chunk size
+//   bytes   chunk, exactly as received
+// varints are little endian base 128, so a busy trace costs two or
+// three bytes per chunk on top of the data.
+class   TraceWriter
+{
+ public:
+  TraceWriter(void) : _last(0) {}
+
+  bool  open(const QString& path);
+  bool  isOpen(void) const { return this->_file.isOpen(); }
+  void  write(const QByteArray& chunk);
+  void  close(void);
+
+ private:
+  void  writeVarint(quint64 value);
+
+ private:
+  QFile         _file;
+  QElapsedTimer _clock;
+  qint64        _last; // microseconds
+};
+
+class   TraceReader
+{
+ public:
+  struct Chunk
+  {
+    qint64     time; // microseconds since the capture started
+    QByteArray data;
+  };
+
+  // Loads the whole trace, false if it is not one.
+  bool  read(const QString& path, QList<Chunk>& chunks);
+  QString errorString(void) const { return this->_error; }
+
+ private:
+  QString _error;
+};
+
+#endif // TRACE_H_
@@ -0,0 +1,82 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRACE_REPLAYER_H_
+#define TRACE_REPLAYER_H_
+
+#include <QTimer>
+#include <QObject>
+#include <QElapsedTimer>
+#include "Trace.h"
+#include "Protocol.h"
+
+class   Network;
+
+// Feeds a capture back through the framer and Protocol::interpretLine,
+// then through Network::dispatchEvents so whatever is connected to the
+// session (the GUI) applies the events as it would live.
+// speed 1 replays at the captured pace, N at N times that pace and 0 as
+// fast as possible. The event loop runs between chunks in every mode.
+// Handshake events are parsed but not dispatched: the session is not
+// connected and must not answer them.
+class   TraceReplayer : public QObject
+{
+  Q_OBJECT
+
+    public:
+  TraceReplayer(Network* network = NULL, QObject* parent = NULL);
+
+  bool  open(const QString& path);
+  QString errorString(void) const { return this->_reader.errorString(); }
+  void  start(const double speed);
+
+  // lines/s, time spent parsing and applying and heap allocations per
+  // line for the decoded fields, valid once finished
+  QString report(void) const;
+
+ signals:
+  void  finished(void);
+
+  private slots:
+  void  replayDue(void);
+
+ private:
+  void  replay(const TraceReader::Chunk& chunk);
+
+ private:
+  Network*                   _network;
+  TraceReader                _reader;
+  QList<TraceReader::Chunk>  _chunks;
+  int                        _next;
+  double                     _speed;
+  Protocol                   _protocol;
+  QList<NetsoulEvent>        _batch;
+  QByteArray                 _replies;
+  QTimer                     _timer;
+  QElapsedTimer              _clock;
+  qint64                     _wall;  // milliseconds
+  quint64                    _lines;
+  quint64                    _events;
+  quint64                    _bytes;
+  qint64                     _parse; // nanoseconds
+  qint64                     _apply; // nanoseconds
+  qint64                     _longestApply;
+  quint64                    _allocations; // field table counters
+  quint64                    _saved;       // at start()
+};
+
+#endif // TRACE_REPLAYER_H_
@@ -0,0 +1,78 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TYPING_SHAPER_H_
+#define TYPING_SHAPER_H_
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+// Typing notifications shaped per destination: only state changes are
+// sent, no closer than minInterval milliseconds apart, and a typing
+// state left without keystrokes for idleTimeout milliseconds is
+// cancelled. A change undone before it could be sent is dropped.
+class   TypingShaper
+{
+ public:
+  struct Notification
+  {
+    QString    key;
+    QByteArray destination;
+    bool       typing;
+  };
+
+  TypingShaper(const int minInterval, const int idleTimeout);
+
+  void  setIntervals(const int minInterval, const int idleTimeout);
+  bool  contains(const QString& key) const
+    { return this->_states.contains(key); }
+  // destination is an opaque prefix handed back with the notifications
+  void  insert(const QString& key, const QByteArray& destination);
+  void  update(const QString& key, const bool typing);
+  // Appends the notifications due now, returns the milliseconds until
+  // the next one may be, -1 if none is pending.
+  int   poll(QList<Notification>& due);
+  void  clear(void);
+
+  quint64 sent(void) const { return this->_sent; }
+  quint64 suppressed(void) const { return this->_suppressed; }
+  quint64 expired(void) const { return this->_expired; }
+
+ private:
+  struct State
+  {
+    QByteArray destination;
+    bool       sent;         // last state sent
+    bool       wanted;       // state to send
+    qint64     lastSent;     // -1: never
+    qint64     lastActivity; // last keystroke
+  };
+
+ private:
+  int           _minInterval;
+  int           _idleTimeout;
+  QHash<QString, State> _states;
+  QElapsedTimer _clock;
+  quint64       _sent;
+  quint64       _suppressed;
+  quint64       _expired;    // cancelled for want of keystrokes
+};
+
+#endif // TYPING_SHAPER_H_
@@ -19,8 +19,14 @@
 #define URL_H
 
 #include <QString>
+#include <QByteArray>
 
 QString	url_encode(const char *in);
 QString	url_decode(const char *in);
+QString	url_decode(const char *in, const int size);
+QString	url_decode(const QByteArray& in);
+// Decodes size bytes into out, which holds at least size bytes, and
+// returns the decoded size. Nothing is allocated.
+int	url_decode(const char *in, const int size, char *out);
 
 #endif // URL_H
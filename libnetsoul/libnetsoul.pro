@@ -0,0 +1,87 @@
+CONFIG += release staticlib
+TEMPLATE = lib
+# Headless: no widgets, usable by qns and qnsd
+QT = core network
+
+DEPENDPATH += . \
+    headers \
+    tpl \
+    src \
+    ../tools
+
+INCLUDEPATH += . \
+    headers \
+    tpl \
+    ../tools
+
+# Inputs
+HEADERS += tpl/SpscQueue.hpp
+HEADERS += headers/Network.h \
+    headers/NetworkWorker.h \
+    headers/Protocol.h \
+    headers/OutboundQueue.h \
+    headers/TokenBucket.h \
+    headers/PresenceScheduler.h \
+    headers/SessionOptions.h \
+    headers/LineBuffer.h \
+    headers/NetsoulEvent.h \
+    headers/Tokenizer.h \
+    headers/Url.h \
+    headers/LocationResolver.h \
+    headers/ContactsFile.h \
+    headers/TimerWheel.h \
+    headers/Trace.h \
+    headers/TraceReplayer.h \
+    headers/LatencyHistogram.h \
+    headers/HostCache.h \
+    headers/TypingShaper.h \
+    headers/Fragmenter.h \
+    headers/Outbox.h \
+    headers/Arena.h \
+    headers/FieldTable.h
+
+SOURCES += src/Network.cpp \
+    src/NetworkWorker.cpp \
+    src/Protocol.cpp \
+    src/OutboundQueue.cpp \
+    src/TokenBucket.cpp \
+    src/PresenceScheduler.cpp \
+    src/LineBuffer.cpp \
+    src/NetsoulEvent.cpp \
+    src/Tokenizer.cpp \
+    src/Url.cpp \
+    src/LocationResolver.cpp \
+    src/ContactsFile.cpp \
+    src/TimerWheel.cpp \
+    src/Trace.cpp \
+    src/TraceReplayer.cpp \
+    src/LatencyHistogram.cpp \
+    src/HostCache.cpp \
+    src/TypingShaper.cpp \
+    src/Fragmenter.cpp \
+    src/Outbox.cpp \
+    src/Arena.cpp \
+    src/FieldTable.cpp
+
+# epoll engine, its sharded runtime and the session handoff, Linux only
+linux {
+    HEADERS += headers/EpollEngine.h \
+        headers/ShardedRuntime.h \
+        headers/SessionHandoff.h
+    SOURCES += src/EpollEngine.cpp \
+        src/ShardedRuntime.cpp \
+        src/SessionHandoff.cpp
+}
+
+# Common inputs
+HEADERS += ../tools/tools.h
+SOURCES += ../tools/tools.cpp
+
+# Output
+TARGET = netsoul
+OBJECTS_DIR = obj
+MOC_DIR = moc
+
+unix:  DESTDIR = .
+win32: DESTDIR = .
+macx:  DESTDIR = .
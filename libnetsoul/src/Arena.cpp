@@ -0,0 +1,90 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include "Arena.h"
+
+namespace
+{
+  const int ALIGNMENT = 16;
+}
+
+Arena::Arena(const int blockSize)
+  : _blockSize(qMax(ALIGNMENT, blockSize)), _current(NULL), _limit(NULL),
+    _allocations(0), _used(0), _blocksAllocated(0)
+{
+}
+
+Arena::~Arena(void)
+{
+  for (int i = 0; i < this->_blocks.size(); ++i)
+    free(this->_blocks.at(i));
+}
+
+void*   Arena::allocate(const int size)
+{
+  const int aligned = (qMax(1, size) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  if (this->_limit - this->_current < aligned)
+    grow(aligned);
+  void* block = this->_current;
+  this->_current += aligned;
+  this->_used += aligned;
+  ++this->_allocations;
+  return block;
+}
+
+char*   Arena::copy(const char* data, const int size)
+{
+  char* block = static_cast<char*>(allocate(size));
+  memcpy(block, data, size);
+  return block;
+}
+
+// The first block is kept: a batch that fits in it costs no malloc.
+void    Arena::reset(void)
+{
+  for (int i = 1; i < this->_blocks.size(); ++i)
+    free(this->_blocks.at(i));
+  if (this->_blocks.size() > 1)
+    this->_blocks.resize(1);
+  this->_current = this->_blocks.isEmpty() ? NULL : this->_blocks.at(0);
+  this->_limit = this->_blocks.isEmpty() ? NULL :
+    this->_current + this->_blockSize;
+  this->_allocations = 0;
+  this->_used = 0;
+}
+
+// Oversized requests get a block of their own size. malloc aligns for
+// any type, ALIGNMENT sized slices keep that alignment.
+void    Arena::grow(const int size)
+{
+  const int capacity = qMax(this->_blockSize, size);
+  char* block = static_cast<char*>(malloc(capacity));
+  Q_CHECK_PTR(block);
+  // The first block is the one kept by reset(), it must be a full one
+  if (this->_blocks.isEmpty() && capacity != this->_blockSize)
+    {
+      this->_blocks.append(static_cast<char*>(malloc(this->_blockSize)));
+      Q_CHECK_PTR(this->_blocks.at(0));
+      ++this->_blocksAllocated;
+    }
+  this->_blocks.append(block);
+  ++this->_blocksAllocated;
+  this->_current = block;
+  this->_limit = block + capacity;
+}
@@ -0,0 +1,88 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QIODevice>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include "ContactsFile.h"
+
+ContactsFile::ContactsFile(void)
+{
+}
+
+// Every <login> is taken, whatever its depth: the ones below a
+// BlockedContact are blocked logins, the others are contacts.
+bool    ContactsFile::read(QIODevice* device)
+{
+  QXmlStreamReader xml(device);
+  bool blocked = false;
+
+  this->_logins.clear();
+  this->_blocked.clear();
+  this->_error.clear();
+  while (!xml.atEnd())
+    {
+      xml.readNext();
+      if (xml.isStartElement())
+        {
+          if (xml.name() == "qns" &&
+              xml.attributes().value("version") != "1.0")
+            xml.raiseError(QObject::tr("The file is not a qns version 1.0 file."));
+          else if (xml.name() == "BlockedContact")
+            blocked = true;
+          else if (xml.name() == "login")
+            {
+              const QString login = xml.readElementText();
+              if (!login.isEmpty())
+                (blocked ? this->_blocked : this->_logins) << login;
+            }
+        }
+      else if (xml.isEndElement() && xml.name() == "BlockedContact")
+        blocked = false;
+    }
+  if (xml.hasError())
+    this->_error = xml.errorString();
+  return !xml.hasError();
+}
+
+// Same layout as ContactsWriter, without groups.
+bool    ContactsFile::write(QIODevice* device) const
+{
+  QXmlStreamWriter xml(device);
+
+  xml.setAutoFormatting(true);
+  xml.writeStartDocument();
+  xml.writeDTD("<!DOCTYPE qns>");
+  xml.writeStartElement("qns");
+  xml.writeAttribute("version", "1.0");
+  for (int i = 0; i < this->_logins.size(); ++i)
+    {
+      xml.writeStartElement("Contact");
+      xml.writeAttribute("expanded", "no");
+      xml.writeTextElement("alias", this->_logins.at(i));
+      xml.writeTextElement("login", this->_logins.at(i));
+      xml.writeEndElement();
+    }
+  for (int i = 0; i < this->_blocked.size(); ++i)
+    {
+      xml.writeStartElement("BlockedContact");
+      xml.writeTextElement("login", this->_blocked.at(i));
+      xml.writeEndElement();
+    }
+  xml.writeEndDocument();
+  return !xml.hasError();
+}
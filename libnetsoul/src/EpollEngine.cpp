@@ -0,0 +1,396 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <QDateTime>
+#include <QHostAddress>
+#include "Url.h"
+#include "EpollEngine.h"
+#include "OutboundQueue.h"
+#include "LocationResolver.h"
+#include "tools.h"
+
+namespace
+{
+  const int MAX_EVENTS = 256;
+  const int MAX_RETRIES = 10;
+  // Milliseconds, same values as Network
+  const int PING_INTERVAL = 10000;
+  const int RECONNECTION_TIME = 1000;
+  const int MAX_RECONNECTION_TIME = 60000;
+}
+
+EpollEngine::EpollEngine(void)
+  : _epoll(-1), _running(false), _listener(NULL)
+{
+}
+
+EpollEngine::~EpollEngine(void)
+{
+  for (int i = 0; i < this->_sessions.size(); ++i)
+    {
+      if (this->_sessions.at(i)->fd >= 0)
+        ::close(this->_sessions.at(i)->fd);
+      delete this->_sessions.at(i);
+    }
+  if (this->_epoll >= 0)
+    ::close(this->_epoll);
+}
+
+bool    EpollEngine::init(void)
+{
+  this->_epoll = epoll_create1(EPOLL_CLOEXEC);
+  this->_clock.start();
+  this->_wheel.start(this->_clock.elapsed());
+  return this->_epoll >= 0;
+}
+
+// Built once, written as is by every session.
+void    EpollEngine::setContacts(const QStringList& logins)
+{
+  OutboundQueue queue;
+  queue.appendWatch(logins);
+  queue.appendWho(logins);
+  this->_presenceCommands = queue.take(INT_MAX);
+}
+
+// Sessions sharing server and credentials share their Login.
+int     EpollEngine::addSession(const SessionOptions& options)
+{
+  int login = this->_logins.size() - 1;
+  if (login < 0 ||
+      this->_logins.at(login).name != options.login.toUtf8() ||
+      this->_logins.at(login).rawLocation != options.location)
+    {
+      const QString key = options.server + ':' + QString::number(options.port);
+      QByteArray address = this->_addresses.value(key);
+      if (address.isEmpty())
+        {
+          addrinfo hints;
+          addrinfo* result = NULL;
+          memset(&hints, 0, sizeof(hints));
+          hints.ai_family = AF_INET;
+          hints.ai_socktype = SOCK_STREAM;
+          if (getaddrinfo(options.server.toUtf8().constData(),
+                          QByteArray::number(options.port).constData(),
+                          &hints, &result) != 0 || NULL == result)
+            return -1;
+          address = QByteArray(reinterpret_cast<const char*>(result->ai_addr),
+                               result->ai_addrlen);
+          freeaddrinfo(result);
+          this->_addresses.insert(key, address);
+        }
+      Login entry;
+      entry.address = address;
+      entry.name = options.login.toUtf8();
+      entry.password = options.password.toUtf8();
+      entry.rawLocation = options.location;
+      if (!options.location.isEmpty() && !options.location.contains("%L"))
+        entry.location =
+          url_encode(options.location.toStdString().c_str()).toUtf8();
+      entry.comment =
+        url_encode((options.comment.isEmpty() ?
+                    Tools::defaultComment() :
+                    options.comment).toStdString().c_str()).toUtf8();
+      this->_logins.append(entry);
+      login = this->_logins.size() - 1;
+    }
+  Session* session = new Session;
+  session->login = login;
+  this->_sessions.append(session);
+  return this->_sessions.size() - 1;
+}
+
+void    EpollEngine::connectAll(void)
+{
+  for (int i = 0; i < this->_sessions.size(); ++i)
+    if (Idle == this->_sessions.at(i)->status)
+      connectSession(i);
+}
+
+void    EpollEngine::run(void)
+{
+  this->_running = true;
+  while (this->_running)
+    runOnce(-1);
+}
+
+// Waits at most until the next wheel tick. Returns the number of
+// descriptors that were ready.
+int     EpollEngine::runOnce(const int timeout)
+{
+  epoll_event events[MAX_EVENTS];
+  int wait = this->_wheel.msecsToNextTick(this->_clock.elapsed());
+  if (timeout >= 0 && timeout < wait)
+    wait = timeout;
+
+  const int ready = epoll_wait(this->_epoll, events, MAX_EVENTS, wait);
+  for (int i = 0; i < ready; ++i)
+    {
+      const int id = static_cast<int>(events[i].data.u32);
+      const quint32 flags = events[i].events;
+      if (flags & (EPOLLERR | EPOLLHUP))
+        {
+          closeSession(id, true);
+          continue;
+        }
+      if (flags & EPOLLOUT)
+        handleWritable(id);
+      if ((flags & (EPOLLIN | EPOLLRDHUP)) &&
+          Connected == this->_sessions.at(id)->status)
+        handleReadable(id);
+    }
+  fireTimers();
+  return ready < 0 ? 0 : ready;
+}
+
+void    EpollEngine::connectSession(const int id)
+{
+  Session* session = this->_sessions[id];
+  const QByteArray& address = this->_logins.at(session->login).address;
+  const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          0);
+  if (fd < 0)
+    {
+      closeSession(id, true);
+      return;
+    }
+  const int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  session->fd = fd;
+  session->status = Connecting;
+  session->protocol.reset();
+  session->out.resize(0);
+  session->written = 0;
+  if (::connect(fd, reinterpret_cast<const sockaddr*>(address.constData()),
+                address.size()) < 0 && EINPROGRESS != errno)
+    {
+      closeSession(id, true);
+      return;
+    }
+  epoll_event event;
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  event.data.u32 = static_cast<quint32>(id);
+  epoll_ctl(this->_epoll, EPOLL_CTL_ADD, fd, &event);
+}
+
+// Pending timers of the session die with its generation.
+void    EpollEngine::closeSession(const int id, const bool reconnect)
+{
+  Session* session = this->_sessions[id];
+  if (session->fd >= 0)
+    {
+      epoll_ctl(this->_epoll, EPOLL_CTL_DEL, session->fd, NULL);
+      ::close(session->fd);
+      session->fd = -1;
+      ++this->_stats.closed;
+    }
+  if (Connected == session->status)
+    --this->_stats.connected;
+  session->status = Idle;
+  ++session->generation;
+  if (reconnect && session->retries < MAX_RETRIES)
+    {
+      const int delay = qMin(RECONNECTION_TIME << session->retries,
+                             MAX_RECONNECTION_TIME);
+      ++session->retries;
+      this->_wheel.schedule(id, ReconnectTimer, session->generation,
+                            delay / 2 + Tools::rand_n(delay / 2 + 1));
+    }
+}
+
+void    EpollEngine::handleWritable(const int id)
+{
+  Session* session = this->_sessions[id];
+  if (Connecting == session->status)
+    {
+      int error = 0;
+      socklen_t size = sizeof(error);
+      getsockopt(session->fd, SOL_SOCKET, SO_ERROR, &error, &size);
+      if (error != 0)
+        {
+          closeSession(id, true);
+          return;
+        }
+      session->status = Connected;
+      ++this->_stats.connected;
+      // Data may have arrived with the connection
+      handleReadable(id);
+      return;
+    }
+  flush(id);
+}
+
+// Edge-triggered: drain the socket completely, then parse in place.
+void    EpollEngine::handleReadable(const int id)
+{
+  Session* session = this->_sessions[id];
+  bool closed;
+  const qint64 bytes = session->protocol.buffer().readFrom(session->fd,
+                                                           closed);
+  this->_stats.bytesIn += bytes;
+  if (bytes > 0)
+    {
+      this->_stats.lines +=
+        session->protocol.parseLines(this->_events, this->_replies);
+      if (!this->_replies.isEmpty())
+        {
+          send(id, this->_replies);
+          this->_replies.clear();
+        }
+      for (int i = 0; i < this->_events.size() &&
+             Connected == session->status; ++i)
+        handleEvent(id, this->_events.at(i));
+      this->_events.clear();
+    }
+  if (closed && Idle != session->status)
+    closeSession(id, true);
+}
+
+// Same login sequence as Network::processHandShaking
+void    EpollEngine::handleEvent(const int id, const NetsoulEvent& event)
+{
+  Session* session = this->_sessions[id];
+  const Login& login = this->_logins.at(session->login);
+
+  if (NetsoulEvent::HandShakingEvent != event.type)
+    {
+      if (this->_listener)
+        this->_listener->sessionEvent(id, event);
+      return;
+    }
+  switch (event.step)
+    {
+    case Protocol::WaitingSalut:
+      if (event.args.size() > 5)
+        send(id, Protocol::loginCommands
+             (event.args, login.name, login.password,
+              login.location.isEmpty() ?
+              resolveLocation(session->fd, login) : login.location,
+              login.comment));
+      break;
+    case Protocol::WaitingLogReply:
+      {
+        QByteArray state("state actif:");
+        state.append(QByteArray::number(QDateTime::currentDateTime()
+                                        .toTime_t()));
+        state.append('\n');
+        state.append(this->_presenceCommands);
+        send(id, state);
+        session->retries = 0;
+        ++this->_stats.netsouled;
+        this->_wheel.schedule(id, PingTimer, session->generation,
+                              PING_INTERVAL);
+        break;
+      }
+    case -1:
+      ++this->_stats.failed;
+      closeSession(id, false);
+      break;
+    default:;
+    }
+}
+
+void    EpollEngine::send(const int id, const QByteArray& data)
+{
+  Session* session = this->_sessions[id];
+  if (session->fd < 0)
+    return;
+  if (session->out.capacity() == 0)
+    session->out.reserve(512); // keeps the buffer across resize(0)
+  session->out.append(data);
+  flush(id);
+}
+
+// Writes until the kernel buffer is full, EPOLLOUT resumes it.
+void    EpollEngine::flush(const int id)
+{
+  Session* session = this->_sessions[id];
+  while (session->written < session->out.size())
+    {
+      const ssize_t written =
+        ::send(session->fd, session->out.constData() + session->written,
+               session->out.size() - session->written, MSG_NOSIGNAL);
+      if (written > 0)
+        {
+          session->written += static_cast<int>(written);
+          this->_stats.bytesOut += written;
+        }
+      else if (written < 0 && EINTR == errno)
+        continue;
+      else if (written < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+        return;
+      else
+        {
+          closeSession(id, true);
+          return;
+        }
+    }
+  session->out.resize(0);
+  session->written = 0;
+}
+
+void    EpollEngine::fireTimers(void)
+{
+  this->_wheel.advance(this->_clock.elapsed(), this->_expired);
+  for (int i = 0; i < this->_expired.size(); ++i)
+    {
+      const TimerWheel::Timer& timer = this->_expired.at(i);
+      Session* session = this->_sessions[timer.owner];
+      if (timer.generation != session->generation)
+        continue;
+      switch (timer.kind)
+        {
+        case PingTimer:
+          send(timer.owner, "ping\n");
+          if (timer.generation == session->generation)
+            this->_wheel.schedule(timer.owner, PingTimer,
+                                  session->generation, PING_INTERVAL);
+          break;
+        case ReconnectTimer:
+          connectSession(timer.owner);
+          break;
+        }
+    }
+  this->_expired.resize(0);
+}
+
+QByteArray      EpollEngine::resolveLocation(const int fd,
+                                             const Login& login) const
+{
+  sockaddr_storage local;
+  socklen_t size = sizeof(local);
+  QHostAddress address;
+  if (0 == getsockname(fd, reinterpret_cast<sockaddr*>(&local), &size))
+    address.setAddress(reinterpret_cast<const sockaddr*>(&local));
+
+  QString location(login.rawLocation);
+  if (location.isEmpty())
+    location = LocationResolver::resolve(address);
+  else
+    location.replace("%L", LocationResolver::resolve(address));
+  return url_encode(location.toStdString().c_str()).toUtf8();
+}
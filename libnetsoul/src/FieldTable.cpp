@@ -0,0 +1,125 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <QHash>
+#include "Url.h"
+#include "FieldTable.h"
+
+namespace
+{
+  const int MIN_CAPACITY = 256;
+  // Where url_decode(const char*, int) goes to the heap: the old
+  // std::string scratch did past its 15 bytes inline buffer.
+  const int INLINE_SCRATCH = 15;
+}
+
+FieldTable::FieldTable(void)
+  : _slots(NULL), _capacity(0), _allocations(0), _saved(0)
+{
+}
+
+QString FieldTable::field(const char* data, const int size)
+{
+  return lookup(data, size, false);
+}
+
+QString FieldTable::encodedField(const char* data, const int size)
+{
+  if (size > INLINE_SCRATCH)
+    ++this->_saved;
+  return lookup(data, size, true);
+}
+
+QString FieldTable::encodedText(const char* data, const int size)
+{
+  if (size > INLINE_SCRATCH)
+    ++this->_saved;
+  return decode(data, size);
+}
+
+// The QStrings handed out stay valid, they only lose their sharing.
+void    FieldTable::clear(void)
+{
+  this->_values.resize(0);
+  this->_arena.reset();
+  this->_slots = NULL;
+  this->_capacity = 0;
+}
+
+QString FieldTable::lookup(const char* data, const int size,
+                           const bool encoded)
+{
+  if (size <= 0)
+    return QString();
+  if (this->_values.size() * 2 >= this->_capacity)
+    rehash(qMax(MIN_CAPACITY, this->_capacity * 2));
+  const uint hash = qHashBits(data, size, encoded ? 1 : 0);
+  const int mask = this->_capacity - 1;
+  int i = hash & mask;
+  for (; this->_slots[i] != NULL; i = (i + 1) & mask)
+    {
+      const Entry* entry = this->_slots[i];
+      if (entry->hash == hash && entry->encoded == encoded &&
+          entry->size == size && 0 == memcmp(entry->data, data, size))
+        {
+          ++this->_saved;
+          return this->_values.at(entry->value);
+        }
+    }
+  Entry* entry = static_cast<Entry*>(this->_arena.allocate(sizeof(Entry)));
+  entry->hash = hash;
+  entry->encoded = encoded;
+  entry->size = size;
+  entry->data = this->_arena.copy(data, size);
+  entry->value = this->_values.size();
+  this->_values.append(encoded ? decode(data, size) :
+                       QString::fromUtf8(data, size));
+  if (!encoded)
+    ++this->_allocations;
+  this->_slots[i] = entry;
+  return this->_values.last();
+}
+
+QString FieldTable::decode(const char* data, const int size)
+{
+  char* scratch = static_cast<char*>(this->_arena.allocate(size));
+  const int length = url_decode(data, size, scratch);
+  if (length > 0)
+    ++this->_allocations;
+  return QString::fromUtf8(scratch, length);
+}
+
+// The old slots stay in the arena until clear(), a batch rarely grows
+// the table more than once.
+void    FieldTable::rehash(const int capacity)
+{
+  Entry** slots =
+    static_cast<Entry**>(this->_arena.allocate(capacity * sizeof(Entry*)));
+  memset(slots, 0, capacity * sizeof(Entry*));
+  const int mask = capacity - 1;
+  for (int i = 0; i < this->_capacity; ++i)
+    if (this->_slots[i] != NULL)
+      {
+        int j = this->_slots[i]->hash & mask;
+        while (slots[j] != NULL)
+          j = (j + 1) & mask;
+        slots[j] = this->_slots[i];
+      }
+  this->_slots = slots;
+  this->_capacity = capacity;
+}
@@ -0,0 +1,212 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDebug>
+#include "Url.h"
+#include "Fragmenter.h"
+
+namespace
+{
+  const int MAX_FRAGMENTS = 8192;
+  const int MAX_PENDING = 64;        // unfinished messages kept
+  const qint64 FRAGMENT_TIMEOUT = 120000; // milliseconds
+  // Budget a cut may give up to end on a newline or a space
+  const int BOUNDARY_SLACK = 4;      // one fourth
+  // Line breaks, best first: as Chat sends them ("<br />"), then raw
+  // (qnsd, plugins), then a space
+  const char* const BOUNDARIES[] = { "%3Cbr%20%2F%3E", "%0A", "%20" };
+  const int BOUNDARY_COUNT = 3;
+
+  bool  isEscape(const QByteArray& encoded, const int i)
+  {
+    return i >= 0 && i + 2 < encoded.size() && '%' == encoded.at(i);
+  }
+
+  // An escaped UTF-8 continuation byte, %80 to %BF
+  bool  isContinuation(const QByteArray& encoded, const int i)
+  {
+    if (!isEscape(encoded, i))
+      return false;
+    const char c = encoded.at(i + 1);
+    return '8' == c || '9' == c || 'A' == c || 'B' == c;
+  }
+
+  int   cutAt(const QByteArray& encoded, const int from, const int room)
+  {
+    if (from + room >= encoded.size())
+      return encoded.size();
+    int end = from + room;
+    if ('%' == encoded.at(end - 1))
+      end -= 1;
+    else if (end >= 2 && '%' == encoded.at(end - 2))
+      end -= 2;
+    while (end - 3 > from && isContinuation(encoded, end))
+      end -= 3;
+    const int floor = qMax(from, end - room / BOUNDARY_SLACK);
+    for (int i = 0; i < BOUNDARY_COUNT; ++i)
+      {
+        const int size = static_cast<int>(qstrlen(BOUNDARIES[i]));
+        const int boundary = encoded.lastIndexOf(BOUNDARIES[i], end - size);
+        if (boundary >= floor)
+          {
+            end = boundary + size;
+            break;
+          }
+      }
+    return end > from ? end : from + room;
+  }
+}
+
+QList<QByteArray>       Fragmenter::split(const QString& message,
+                                          const int id, const int budget)
+{
+  const QByteArray encoded =
+    url_encode(message.toStdString().c_str()).toUtf8();
+  QList<QByteArray> pieces;
+  if (encoded.size() <= budget)
+    {
+      pieces.append(encoded);
+      return pieces;
+    }
+
+  // The tag size depends on the number of pieces: cut again until the
+  // count fits the digits reserved for it.
+  QList<int> cuts;
+  for (int digits = 1;; )
+    {
+      const int room = qMax(16, budget - tagSize(id, digits));
+      cuts.clear();
+      for (int from = 0; from < encoded.size(); )
+        {
+          from = cutAt(encoded, from, room);
+          cuts.append(from);
+        }
+      const int needed = QByteArray::number(cuts.size()).size();
+      if (needed <= digits)
+        break;
+      digits = needed;
+    }
+
+  const QByteArray count = QByteArray::number(cuts.size());
+  int from = 0;
+  for (int i = 0; i < cuts.size(); ++i)
+    {
+      const QByteArray tag = "[#" + QByteArray::number(id) + ' ' +
+        QByteArray::number(i + 1) + '/' + count + "] ";
+      QByteArray piece(url_encode(tag.constData()).toUtf8());
+      piece.append(encoded.constData() + from, cuts.at(i) - from);
+      pieces.append(piece);
+      from = cuts.at(i);
+    }
+  return pieces;
+}
+
+bool    Fragmenter::reassemble(const QString& sender, const QString& text,
+                               QString& message)
+{
+  int id, index, count, length;
+  if (!parseTag(text, id, index, count, length))
+    {
+      message = text;
+      return true;
+    }
+
+  expire();
+  const QString key = sender + '#' + QString::number(id);
+  QHash<QString, Pending>::iterator it = this->_pending.find(key);
+  if (it != this->_pending.end() && it->parts.size() != count)
+    {
+      this->_pending.erase(it);
+      it = this->_pending.end();
+    }
+  if (it == this->_pending.end())
+    {
+      if (this->_pending.size() >= MAX_PENDING)
+        {
+#ifndef QT_NO_DEBUG
+          qDebug() << "[Fragmenter::reassemble] Too many unfinished"
+                   << "messages, dropping" << key;
+#endif
+          return false;
+        }
+      Pending pending;
+      pending.parts.resize(count);
+      pending.received = 0;
+      it = this->_pending.insert(key, pending);
+    }
+  Pending& pending = it.value();
+  pending.updated.start();
+  QString& part = pending.parts[index - 1];
+  if (part.isNull())
+    ++pending.received;
+  part = text.mid(length);
+  if (pending.received < count)
+    return false;
+
+  message.clear();
+  for (int i = 0; i < count; ++i)
+    message += pending.parts.at(i);
+  this->_pending.erase(it);
+  return true;
+}
+
+int     Fragmenter::tagSize(const int id, const int digits)
+{
+  const QByteArray number(digits, '9');
+  const QByteArray tag =
+    "[#" + QByteArray::number(id) + ' ' + number + '/' + number + "] ";
+  return url_encode(tag.constData()).size();
+}
+
+// "[#id k/n] ", 1 <= k <= n
+bool    Fragmenter::parseTag(const QString& text, int& id, int& index,
+                             int& count, int& length)
+{
+  if (!text.startsWith("[#"))
+    return false;
+  const int space = text.indexOf(' ', 2);
+  const int slash = text.indexOf('/', space + 1);
+  const int close = text.indexOf("] ", slash + 1);
+  if (space < 0 || slash < 0 || close < 0)
+    return false;
+  bool ok[3];
+  id = text.mid(2, space - 2).toInt(&ok[0]);
+  index = text.mid(space + 1, slash - space - 1).toInt(&ok[1]);
+  count = text.mid(slash + 1, close - slash - 1).toInt(&ok[2]);
+  length = close + 2;
+  return ok[0] && ok[1] && ok[2] && count > 1 && count <= MAX_FRAGMENTS &&
+    index >= 1 && index <= count;
+}
+
+// Fragments of a message whose sender went silent are dropped.
+void    Fragmenter::expire(void)
+{
+  QHash<QString, Pending>::iterator it = this->_pending.begin();
+  while (it != this->_pending.end())
+    {
+      if (it->updated.hasExpired(FRAGMENT_TIMEOUT))
+        {
+#ifndef QT_NO_DEBUG
+          qDebug() << "[Fragmenter::expire] Unfinished message from"
+                   << it.key() << it->received << '/' << it->parts.size();
+#endif
+          it = this->_pending.erase(it);
+        }
+      else
+        ++it;
+    }
+}
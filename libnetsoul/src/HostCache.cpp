@@ -0,0 +1,40 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "HostCache.h"
+
+namespace
+{
+  const qint64 TIME_TO_LIVE = 600000; // milliseconds
+}
+
+QString HostCache::lookup(const QString& host) const
+{
+  QHash<QString, Entry>::const_iterator it = this->_entries.find(host);
+  if (it == this->_entries.end() || it->stored.hasExpired(TIME_TO_LIVE))
+    return host;
+  return it->address;
+}
+
+void    HostCache::store(const QString& host, const QString& address)
+{
+  if (address.isEmpty() || address == host)
+    return;
+  Entry& entry = this->_entries[host];
+  entry.address = address;
+  entry.stored.start();
+}
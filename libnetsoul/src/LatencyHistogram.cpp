@@ -0,0 +1,126 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QJsonArray>
+#include "LatencyHistogram.h"
+
+namespace
+{
+  const int SUB_BUCKETS = 16; // per power of two
+  const int SUB_BITS = 4;     // log2(SUB_BUCKETS)
+  const int MAGNITUDES = 60;  // up to 2^64 us
+}
+
+LatencyHistogram::LatencyHistogram(void)
+  : _buckets(SUB_BUCKETS * (MAGNITUDES + 1), 0)
+{
+  reset();
+}
+
+void    LatencyHistogram::record(const qint64 micros)
+{
+  const qint64 value = qMax(qint64(0), micros);
+  ++this->_buckets[bucketOf(static_cast<quint64>(value))];
+  if (0 == this->_count || value < this->_min)
+    this->_min = value;
+  if (0 == this->_count || value > this->_max)
+    this->_max = value;
+  ++this->_count;
+  this->_sum += value;
+  this->_last = value;
+}
+
+void    LatencyHistogram::reset(void)
+{
+  this->_buckets.fill(0);
+  this->_count = 0;
+  this->_sum = 0;
+  this->_last = this->_min = this->_max = -1;
+}
+
+qint64  LatencyHistogram::mean(void) const
+{
+  return this->_count ? static_cast<qint64>(this->_sum / this->_count) : -1;
+}
+
+// The highest value of the bucket holding the sample of rank p,
+// capped by the largest sample seen.
+qint64  LatencyHistogram::percentile(const double p) const
+{
+  if (0 == this->_count)
+    return -1;
+  const quint64 rank =
+    qMax<quint64>(1, static_cast<quint64>(p / 100.0 * this->_count + 0.5));
+  quint64 seen = 0;
+  for (int i = 0; i < this->_buckets.size(); ++i)
+    {
+      seen += this->_buckets.at(i);
+      if (seen >= rank)
+        return qMin(highestOf(i), this->_max);
+    }
+  return this->_max;
+}
+
+QJsonObject     LatencyHistogram::toJson(void) const
+{
+  QJsonObject json;
+  json["unit"] = QString("us");
+  json["count"] = static_cast<double>(this->_count);
+  json["last"] = static_cast<double>(this->_last);
+  json["min"] = static_cast<double>(this->_min);
+  json["max"] = static_cast<double>(this->_max);
+  json["mean"] = static_cast<double>(mean());
+  json["p50"] = static_cast<double>(percentile(50));
+  json["p90"] = static_cast<double>(percentile(90));
+  json["p99"] = static_cast<double>(percentile(99));
+  json["p999"] = static_cast<double>(percentile(99.9));
+
+  // [highest value of the bucket, count]
+  QJsonArray buckets;
+  for (int i = 0; i < this->_buckets.size(); ++i)
+    if (this->_buckets.at(i))
+      {
+        QJsonArray bucket;
+        bucket.append(static_cast<double>(highestOf(i)));
+        bucket.append(static_cast<double>(this->_buckets.at(i)));
+        buckets.append(bucket);
+      }
+  json["buckets"] = buckets;
+  return json;
+}
+
+// Values below SUB_BUCKETS have a bucket each; above, the top SUB_BITS
+// bits after the leading one select the sub-bucket of the magnitude.
+int     LatencyHistogram::bucketOf(const quint64 value)
+{
+  if (value < static_cast<quint64>(SUB_BUCKETS))
+    return static_cast<int>(value);
+  int magnitude = 0;
+  while ((value >> (magnitude + SUB_BITS + 1)) != 0)
+    ++magnitude;
+  const int sub = static_cast<int>(value >> magnitude) - SUB_BUCKETS;
+  return SUB_BUCKETS * (magnitude + 1) + sub;
+}
+
+qint64  LatencyHistogram::highestOf(const int bucket)
+{
+  if (bucket < SUB_BUCKETS)
+    return bucket;
+  const int magnitude = bucket / SUB_BUCKETS - 1;
+  const qint64 sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+  return ((sub + 1) << magnitude) - 1;
+}
@@ -0,0 +1,146 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <QIODevice>
+#ifdef Q_OS_UNIX
+# include <unistd.h>
+#endif
+#include "LineBuffer.h"
+
+namespace
+{
+  const int INITIAL_CAPACITY = 4096;
+}
+
+LineBuffer::LineBuffer(void) : _begin(0), _end(0), _scan(0)
+{
+  this->_buffer.resize(INITIAL_CAPACITY);
+}
+
+// Read everything the device has in store, without intermediate copy.
+qint64  LineBuffer::readFrom(QIODevice* device)
+{
+  Q_ASSERT(device);
+  qint64 total = 0;
+  qint64 available;
+
+  while ((available = device->bytesAvailable()) > 0)
+    {
+      reserve(static_cast<int>(available));
+      const qint64 readbytes =
+        device->read(this->_buffer.data() + this->_end,
+                     this->_buffer.size() - this->_end);
+      if (readbytes <= 0)
+        break;
+      this->_end += static_cast<int>(readbytes);
+      total += readbytes;
+    }
+  return total;
+}
+
+#ifdef Q_OS_UNIX
+// Same, straight from a non-blocking descriptor, until it would block.
+// closed is set on end of stream or error.
+qint64  LineBuffer::readFrom(const int fd, bool& closed)
+{
+  qint64 total = 0;
+
+  closed = false;
+  for (;;)
+    {
+      if (this->_end == this->_buffer.size())
+        reserve(this->_buffer.size() / 2);
+      const ssize_t readbytes =
+        ::read(fd, this->_buffer.data() + this->_end,
+               this->_buffer.size() - this->_end);
+      if (readbytes > 0)
+        {
+          this->_end += static_cast<int>(readbytes);
+          total += readbytes;
+        }
+      else if (readbytes < 0 && EINTR == errno)
+        continue;
+      else
+        {
+          closed = (0 == readbytes ||
+                    (EAGAIN != errno && EWOULDBLOCK != errno));
+          break;
+        }
+    }
+  return total;
+}
+#endif
+
+void    LineBuffer::append(const char* data, const int size)
+{
+  if (size <= 0) return;
+  reserve(size);
+  memcpy(this->_buffer.data() + this->_end, data, size);
+  this->_end += size;
+}
+
+// Gives the next complete line (without its '\n') as a view on the buffer.
+// Bytes already scanned are never scanned twice.
+bool    LineBuffer::nextLine(QByteArray& line)
+{
+  const char* data = this->_buffer.constData();
+  const char* newline = static_cast<const char*>
+    (memchr(data + this->_scan, '\n', this->_end - this->_scan));
+
+  if (newline == NULL)
+    {
+      this->_scan = this->_end;
+      return false;
+    }
+  const int lineEnd = static_cast<int>(newline - data);
+  line = QByteArray::fromRawData(data + this->_begin, lineEnd - this->_begin);
+  this->_begin = this->_scan = lineEnd + 1;
+  return true;
+}
+
+// Move the incomplete tail (if any) back to the front of the buffer.
+// Called once per batch, so the cost is bounded by the partial line.
+void    LineBuffer::compact(void)
+{
+  if (this->_begin == 0) return;
+  const int remaining = this->_end - this->_begin;
+  if (remaining > 0)
+    memmove(this->_buffer.data(),
+            this->_buffer.constData() + this->_begin, remaining);
+  this->_scan -= this->_begin;
+  this->_begin = 0;
+  this->_end = remaining;
+}
+
+void    LineBuffer::clear(void)
+{
+  this->_begin = this->_end = this->_scan = 0;
+}
+
+void    LineBuffer::reserve(const int size)
+{
+  if (this->_end + size <= this->_buffer.size())
+    return;
+  compact();
+  int capacity = this->_buffer.size();
+  while (this->_end + size > capacity)
+    capacity *= 2;
+  if (capacity != this->_buffer.size())
+    this->_buffer.resize(capacity);
+}
@@ -0,0 +1,126 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <QDataStream>
+#include "Tokenizer.h"
+#include "FieldTable.h"
+#include "NetsoulEvent.h"
+
+namespace
+{
+  const int MAX_COLONS = 16;
+
+  struct StateName
+  {
+    const char*         name;
+    NetsoulEvent::State state;
+  };
+}
+
+// Fills id, login, ip, location and promo from the given field:
+// 566:user:1/3:sundas_c@0.0.0.0:~:maison:epitech_2011
+// field 0 is the id, field 3 is login@ip,
+// the two last fields are the location and the promo.
+// Separators were already located by the tokenizer, bytes are not rescanned.
+// Strings come from the batch field table, shared with earlier lines.
+bool    NetsoulEvent::parseConnectionInfo(const Tokenizer& tokens,
+                                          const int field,
+                                          FieldTable& fields)
+{
+  const Tokenizer::Field& info = tokens.field(field);
+  const int* marks = tokens.marks(field);
+  const char* data = tokens.data();
+  int colons[MAX_COLONS];
+  int count = 0;
+  int at = -1;
+
+  for (int i = 0; i < info.markCount && count < MAX_COLONS; ++i)
+    if (':' == data[marks[i]])
+      colons[count++] = marks[i];
+    else if (count == 3 && at < 0)
+      at = marks[i];
+  if (count < 5)
+    return false;
+
+  bool ok;
+  this->id = QByteArray::fromRawData(data + info.begin,
+                                     colons[0] - info.begin).toInt(&ok);
+  if (!ok)
+    return false;
+
+  const int userBegin = colons[2] + 1;
+  const int userEnd = colons[3];
+  if (at < 0)
+    at = userEnd;
+  this->login = fields.field(data + userBegin, at - userBegin);
+  this->ip = (at < userEnd)?
+    fields.field(data + at + 1, userEnd - at - 1) : this->login;
+  this->location =
+    fields.encodedField(data + colons[count - 2] + 1,
+                        colons[count - 1] - colons[count - 2] - 1);
+  this->promo = fields.field(data + colons[count - 1] + 1,
+                             info.end - colons[count - 1] - 1);
+  return true;
+}
+
+// Accepts a bare state name or a state followed by its timestamp
+// (actif:1281147031). Login events are displayed as "connection".
+NetsoulEvent::State NetsoulEvent::toState(const QByteArray& name)
+{
+  static const StateName names[] =
+    {
+      {"connection", Connection},
+      {"login",      Connection},
+      {"logout",     Logout},
+      {"actif",      Actif},
+      {"away",       Away},
+      {"idle",       Idle},
+      {"lock",       Lock},
+      {"server",     Server},
+      {NULL,         Unknown}
+    };
+  int size = name.indexOf(':');
+  if (size < 0)
+    size = name.size();
+  for (int i = 0; (names[i].name); ++i)
+    if (static_cast<int>(strlen(names[i].name)) == size &&
+        0 == memcmp(names[i].name, name.constData(), size))
+      return names[i].state;
+  return Unknown;
+}
+
+QDataStream&    operator<<(QDataStream& out, const NetsoulEvent& event)
+{
+  out << static_cast<qint32>(event.id) << static_cast<qint32>(event.state)
+      << event.login << event.ip << event.promo
+      << event.location << event.comment;
+  return out;
+}
+
+QDataStream&    operator>>(QDataStream& in, NetsoulEvent& event)
+{
+  qint32 id = -1;
+  qint32 state = NetsoulEvent::Unknown;
+  in >> id >> state >> event.login >> event.ip >> event.promo
+     >> event.location >> event.comment;
+  event.type = NetsoulEvent::WhoEvent;
+  event.id = id;
+  event.state = (state >= 0 && state <= NetsoulEvent::Unknown) ?
+    static_cast<NetsoulEvent::State>(state) : NetsoulEvent::Unknown;
+  return in;
+}
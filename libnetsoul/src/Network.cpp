@@ -0,0 +1,965 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDateTime>
+#include <QDataStream>
+#include <QCoreApplication>
+#include "Url.h"
+#include "Network.h"
+#include "NetworkWorker.h"
+#include "LocationResolver.h"
+#include "tools.h"
+
+namespace
+{
+  const int MAX_RETRIES = 10;
+  // Reconnection backoff, doubled on each retry, in milliseconds
+  const int RECONNECTION_TIME = 1000;
+  const int MAX_RECONNECTION_TIME = 60000;
+  // Health scores of the endpoints
+  const int MIN_SCORE = -4;
+  const int MAX_SCORE = 4;
+  const int DEAD_PEER_PENALTY = 4;
+  const int MAX_PARALLEL_ATTEMPTS = 3;
+  const int LIVENESS_CHECKS = 4; // per deadline
+  // Flood control, in bytes
+  // Above this many unsent bytes only critical commands are written
+  const int HIGH_WATERMARK = 16384;
+  const int BACKPRESSURE_DELAY = 100;
+  // Time given to the server to answer a command, in milliseconds:
+  // past it, a ping is no longer mistaken for an earlier command
+  const int REPLY_SETTLE = 2000;
+  // Longest url-encoded message text sent in one line, in bytes
+  const int MAX_MSG_PAYLOAD = 1024;
+  const quint32 HANDOFF_VERSION = 1;
+}
+
+Network::Network(QObject* parent)
+  : QObject(parent), _endpoint(-1), _reconnectWhenClosed(false),
+    _resuming(false),
+    _worker(new NetworkWorker),
+    _bucket(1024, 4096), _typing(1000, 5000),
+    _messageId(static_cast<int>(QDateTime::currentMSecsSinceEpoch() %
+                                10000)),
+    _outboxOpen(false), _bytesSent(0), _maxWhoInFlight(4),
+    _sweepChunks(0), _sweepLogins(0), _pingSent(-1), _lastCommand(-1),
+    _pingWaiting(-1), _pingsQueued(0), _retries(0),
+    _resolveLocation(false)
+{
+  qRegisterMetaType<QAbstractSocket::SocketState>
+    ("QAbstractSocket::SocketState");
+  this->_reconnectionTimer.setSingleShot(true);
+  this->_flushTimer.setSingleShot(true);
+  QObject::connect(&this->_flushTimer, SIGNAL(timeout()), SLOT(flush()));
+  this->_typingTimer.setSingleShot(true);
+  QObject::connect(&this->_typingTimer, SIGNAL(timeout()),
+                   SLOT(flushTyping()));
+  QObject::connect(&this->_reconnectionTimer, SIGNAL(timeout()),
+                   SLOT(reconnect()));
+  QObject::connect(&this->_pingTimer, SIGNAL(timeout()), SLOT(ping()));
+  QObject::connect(&this->_livenessTimer, SIGNAL(timeout()),
+                   SLOT(checkLiveness()));
+  QObject::connect(this->_worker, SIGNAL(eventsReady()),
+                   SLOT(drainEvents()));
+  QObject::connect(this->_worker,
+                   SIGNAL(stateChanged(QAbstractSocket::SocketState,
+                                       const QString&)),
+                   SLOT(handleSocketState(QAbstractSocket::SocketState,
+                                          const QString&)));
+  QObject::connect(this->_worker, SIGNAL(socketError(const QString&)),
+                   SLOT(handleSocketError(const QString&)));
+  QObject::connect(this->_worker,
+                   SIGNAL(endpointConnected(int, const QString&)),
+                   SLOT(handleEndpointConnected(int, const QString&)));
+  QObject::connect(this->_worker, SIGNAL(endpointFailed(int)),
+                   SLOT(handleEndpointFailed(int)));
+  QObject::connect(this->_worker, SIGNAL(bytesWritten(qint64)),
+                   SLOT(acknowledgeMessages(qint64)));
+  for (int i = 0; i < LoginPhaseCount; ++i)
+    this->_loginPhases[i] = -1;
+  this->_clock.start();
+  this->_worker->moveToThread(&this->_thread);
+  QObject::connect(&this->_thread, SIGNAL(finished()),
+                   this->_worker, SLOT(deleteLater()));
+  this->_thread.start();
+}
+
+Network::~Network(void)
+{
+  QMetaObject::invokeMethod(this->_worker, "close",
+                            Qt::BlockingQueuedConnection);
+  this->_thread.quit();
+  this->_thread.wait();
+}
+
+// Taken into account on the next connect(), but for the capture
+// which starts or stops right away. Health scores survive as long as
+// the endpoints do not change.
+void    Network::setSessionOptions(const SessionOptions& options)
+{
+  if (options.outbox != this->_options.outbox &&
+      !this->_outbox.open(options.outbox))
+    qWarning("Cannot open the outbox %s: %s", qPrintable(options.outbox),
+             qPrintable(this->_outbox.errorString()));
+  if (options.capture != this->_options.capture)
+    QMetaObject::invokeMethod(this->_worker, "setCapture",
+                              Qt::QueuedConnection,
+                              Q_ARG(QString, options.capture));
+  if (this->_endpoints.isEmpty() ||
+      options.server != this->_options.server ||
+      options.port != this->_options.port ||
+      options.fallbacks != this->_options.fallbacks)
+    {
+      this->_endpoints.clear();
+      Endpoint endpoint;
+      endpoint.host = options.server;
+      endpoint.port = options.port;
+      endpoint.score = 0;
+      this->_endpoints.append(endpoint);
+      for (int i = 0; i < options.fallbacks.size(); ++i)
+        {
+          const QString& fallback = options.fallbacks.at(i);
+          const int colon = fallback.lastIndexOf(':');
+          endpoint.host = colon < 0 ? fallback : fallback.left(colon);
+          endpoint.port = colon < 0 ?
+            options.port : fallback.mid(colon + 1).toUShort();
+          if (!endpoint.host.isEmpty() && endpoint.port > 0)
+            this->_endpoints.append(endpoint);
+        }
+    }
+  this->_typing.setIntervals(options.typingInterval, options.typingTimeout);
+  this->_bucket.setRate(options.floodRate, options.floodBurst);
+  this->_options = options;
+}
+
+QAbstractSocket::SocketState    Network::state(void) const
+{
+  return this->_worker->socketState();
+}
+
+// Commands are queued and written together once per event-loop tick.
+// Ping and handshake commands go through this one, they are critical.
+void    Network::sendMessage(const QByteArray& msg)
+{
+  this->_outbound.append(msg);
+  scheduleFlush();
+}
+
+void    Network::connect(void)
+{
+  if (QAbstractSocket::UnconnectedState == state())
+    {
+      for (int i = 0; i < LoginPhaseCount; ++i)
+        this->_loginPhases[i] = -1;
+      this->_loginClock.start();
+      this->_outbound.setChunkBudget(this->_options.chunkBudget);
+      this->_maxWhoInFlight = qMax(1, this->_options.whoInFlight);
+      prepareLogin();
+
+      // Best scores first, configuration order among equals. Every
+      // endpoint within a point of the best is tried at once.
+      QList<int> order;
+      for (int i = 0; i < this->_endpoints.size(); ++i)
+        {
+          int j = order.size();
+          while (j > 0 && this->_endpoints.at(order.at(j - 1)).score <
+                 this->_endpoints.at(i).score)
+            --j;
+          order.insert(j, i);
+        }
+      QStringList endpoints;
+      this->_attempts.clear();
+      this->_endpoint = -1;
+      for (int i = 0; i < order.size() &&
+             this->_attempts.size() < MAX_PARALLEL_ATTEMPTS; ++i)
+        {
+          const Endpoint& endpoint = this->_endpoints.at(order.at(i));
+          if (endpoint.score < this->_endpoints.at(order.first()).score - 1)
+            break;
+          this->_attempts.append(order.at(i));
+          endpoints.append(this->_hosts.lookup(endpoint.host) + ' ' +
+                           QString::number(endpoint.port));
+        }
+      QMetaObject::invokeMethod(this->_worker, "connectToEndpoints",
+                                Qt::QueuedConnection,
+                                Q_ARG(QStringList, endpoints));
+    }
+#ifndef QT_NO_DEBUG
+  else
+    {
+      qDebug() << "[Network::connect] state:" << state();
+    }
+#endif
+}
+
+void    Network::disconnect(void)
+{
+  this->_pingTimer.stop();
+  this->_livenessTimer.stop();
+  // Pending commands belong to the closed session.
+  this->_outbound.clear();
+  this->_typing.clear();
+  this->_typingTimer.stop();
+  this->_outboxOpen = false;
+  this->_messagesInFlight.clear();
+  this->_whoInFlight.clear();
+  this->_sweep.invalidate();
+  this->_pingSent = -1;
+  this->_lastCommand = -1;
+  this->_pingWaiting = -1;
+  this->_pingsQueued = 0;
+  QMetaObject::invokeMethod(this->_worker, "disconnectFromHost",
+                            Qt::QueuedConnection);
+}
+
+int     Network::detach(QByteArray& session)
+{
+  if (QAbstractSocket::ConnectedState != state() || !this->_outboxOpen)
+    return -1;
+  this->_pingTimer.stop();
+  this->_livenessTimer.stop();
+  this->_reconnectionTimer.stop();
+  this->_typingTimer.stop();
+  this->_reconnectWhenClosed = false;
+  flush();
+  QByteArray unread;
+  QMetaObject::invokeMethod(this->_worker, "detach",
+                            Qt::BlockingQueuedConnection,
+                            Q_RETURN_ARG(QByteArray, unread));
+  const int fd = this->_worker->detachedDescriptor();
+  if (fd < 0)
+    {
+      // Writes still pending: the session stays with us
+      this->_pingTimer.start(this->_options.pingInterval);
+      if (this->_options.pingDeadline > 0)
+        this->_livenessTimer.start(qMax(1, this->_options.pingDeadline /
+                                        LIVENESS_CHECKS));
+      return -1;
+    }
+  // What was parsed before is ours: the presence snapshot includes it.
+  // So are the bytesWritten() notifications still queued: what they
+  // acknowledge must not be sent again by the new process.
+  drainEvents();
+  QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+  // Messages left go with the journal
+  this->_outboxOpen = false;
+  this->_messagesInFlight.clear();
+  this->_outbound.clear();
+  session.clear();
+  QDataStream out(&session, QIODevice::WriteOnly);
+  out << HANDOFF_VERSION << unread << this->_loginLocation;
+  return fd;
+}
+
+bool    Network::resume(const int fd, const QByteArray& session)
+{
+  QDataStream in(session);
+  quint32 version = 0;
+  QByteArray unread;
+  in >> version;
+  if (HANDOFF_VERSION != version)
+    {
+      qWarning("Cannot resume session: unknown handoff version %u",
+               version);
+      return false;
+    }
+  prepareLogin();
+  in >> unread >> this->_loginLocation;
+  this->_resuming = true;
+  this->_endpoint = -1;
+  this->_attempts.clear();
+  QMetaObject::invokeMethod(this->_worker, "resume", Qt::QueuedConnection,
+                            Q_ARG(int, fd), Q_ARG(QByteArray, unread));
+  return true;
+}
+
+void    Network::reconnect(void)
+{
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::reconnect] Reconnecting" << this->_options.login;
+#endif
+  emit statusMessage(tr("Reconnecting..."), 0);
+  emit reconnecting();
+  disconnect();
+  connect();
+}
+
+void    Network::resolveLocation(QString& oldLocation) const
+{
+  if (!oldLocation.isEmpty())
+    {
+      oldLocation.replace("%L", LocationResolver::resolve(this->_localAddress));
+    }
+  else
+    {
+      oldLocation = LocationResolver::resolve(this->_localAddress);
+    }
+}
+
+void    Network::refreshContact(const QString& contact)
+{
+  this->_outbound.appendWho(contact);
+  scheduleFlush();
+}
+
+void    Network::refreshContacts(const QStringList& contacts)
+{
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::refreshContacts] refreshing...";
+#endif
+  if (contacts.isEmpty()) return;
+  this->_outbound.appendWho(contacts);
+  scheduleFlush();
+}
+
+void    Network::transmitTypingStatus(const QString& login,
+                                      const QString& location,
+                                      const bool status)
+{
+  const QString key = login + '@' + location;
+  if (!this->_typing.contains(key))
+    {
+      QByteArray destination("user_cmd msg ");
+      destination.append("*:" + login);
+      destination.append("@*");
+      destination.append(url_encode(location.toStdString().c_str()));
+      destination.append("*");
+      this->_typing.insert(key, destination);
+    }
+  this->_typing.update(key, !status);
+  flushTyping();
+}
+
+qint64  Network::transmitMsg(const QString& login,
+                             const QString& location,
+                             const QString& message)
+{
+  QByteArray destination("user_cmd msg ");
+  destination.append("*:" + login);
+  destination.append("@*");
+  destination.append(url_encode(location.toStdString().c_str()));
+  destination.append("*");
+  destination.append(" msg ");
+  const QList<QByteArray> pieces =
+    Fragmenter::split(message, this->_messageId, MAX_MSG_PAYLOAD);
+  if (pieces.size() > 1)
+    this->_messageId = (this->_messageId + 1) % 10000;
+  qint64 id = -1;
+  for (int i = 0; i < pieces.size(); ++i)
+    id = queueMessage(destination + pieces.at(i) + '\n');
+  return id;
+}
+
+qint64  Network::transmitGroupMsg(const QStringList& logins,
+                                  const QString& message)
+{
+  if (logins.isEmpty())
+    return -1;
+  const QList<QByteArray> pieces =
+    Fragmenter::split(message, this->_messageId, MAX_MSG_PAYLOAD);
+  if (pieces.size() > 1)
+    this->_messageId = (this->_messageId + 1) % 10000;
+
+  QList<QByteArray> lists;
+  QByteArray list;
+  for (int i = 0; i < logins.size(); ++i)
+    {
+      const QByteArray login = logins.at(i).toUtf8();
+      if (!list.isEmpty() &&
+          list.size() + login.size() + 2 > this->_options.chunkBudget)
+        {
+          lists.append(list + '}');
+          list.clear();
+        }
+      list.append(list.isEmpty() ? '{' : ',');
+      list.append(login);
+    }
+  lists.append(list + '}');
+  // Every piece to a list before the next list, so that each recipient
+  // gets them in order
+  qint64 id = -1;
+  for (int i = 0; i < lists.size(); ++i)
+    for (int j = 0; j < pieces.size(); ++j)
+      id = queueMessage("user_cmd msg_user " + lists.at(i) + " msg " +
+                        pieces.at(j) + '\n');
+  return id;
+}
+
+// Journaled first, queued for the socket once logged in. The key keeps
+// a message replayed after a reconnection from being queued twice.
+qint64  Network::queueMessage(const QByteArray& command)
+{
+  const qint64 id = this->_outbox.append(command);
+  if (this->_outboxOpen)
+    {
+      this->_outbound.append(command, OutboundQueue::Message,
+                             "outbox:" + QString::number(id), id);
+      scheduleFlush();
+    }
+  return id;
+}
+
+// Messages typed while disconnected, in order
+void    Network::openOutbox(void)
+{
+  this->_outboxOpen = true;
+  const QList<Outbox::Message>& pending = this->_outbox.pending();
+  for (int i = 0; i < pending.size(); ++i)
+    this->_outbound.append(pending.at(i).command, OutboundQueue::Message,
+                           "outbox:" + QString::number(pending.at(i).seq),
+                           pending.at(i).seq);
+  if (!pending.isEmpty())
+    scheduleFlush();
+}
+
+// Messages are over once the socket wrote every byte up to theirs.
+void    Network::acknowledgeMessages(qint64 written)
+{
+  while (!this->_messagesInFlight.isEmpty() &&
+         this->_messagesInFlight.head().second <= written)
+    {
+      const qint64 id = this->_messagesInFlight.dequeue().first;
+      this->_outbox.acknowledge(id);
+      emit messageSent(id);
+    }
+}
+
+void    Network::monitorContact(const QString& contact)
+{
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::monitorContact]" << contact;
+#endif
+  this->_outbound.appendWatch(contact);
+  scheduleFlush();
+}
+
+void    Network::monitorContacts(const QStringList& contacts)
+{
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::monitorContacts]" << contacts;
+#endif
+  if (contacts.isEmpty()) return;
+  this->_outbound.appendWatch(contacts);
+  scheduleFlush();
+}
+
+void    Network::sendStatus(const int& status)
+{
+  const char* state = NULL;
+  switch (status)
+    {
+    case 0: state = "state actif\n"; break;
+    case 1: state = "state lock\n"; break;
+    case 2: state = "state away\n"; break;
+    case 3: state = "state server\n"; break;
+    default: qFatal("[Network::sendStatus] unknown state: %d", status);
+    }
+  // Only the latest pending state matters.
+  this->_outbound.append(state, OutboundQueue::Presence, "state");
+  scheduleFlush();
+}
+
+void    Network::handleSocketState(QAbstractSocket::SocketState state,
+                                   const QString& localAddress)
+{
+  this->_localAddress.setAddress(localAddress);
+  switch(state)
+    {
+    case QAbstractSocket::ConnectedState:
+      reachLoginPhase(TcpConnect);
+      this->_bytesSent = 0;
+      this->_messagesInFlight.clear();
+      this->_pingSent = -1;
+      this->_lastCommand = -1;
+      this->_pingWaiting = -1;
+      this->_retries = 0;
+      this->_reconnectionTimer.stop();
+      if (this->_options.pingDeadline > 0)
+        this->_livenessTimer.start(qMax(1, this->_options.pingDeadline /
+                                        LIVENESS_CHECKS));
+      emit statusMessage(tr("Connected"), 0);
+      // A handed over session is logged in already
+      if (this->_resuming)
+        {
+          this->_resuming = false;
+          this->_pingTimer.start(this->_options.pingInterval);
+          openOutbox();
+          emit statusMessage(tr("Session resumed"), 2000);
+        }
+      break;
+    case QAbstractSocket::UnconnectedState:
+      this->_livenessTimer.stop();
+      // Unwritten messages stay in the outbox for the next session
+      this->_outboxOpen = false;
+      this->_messagesInFlight.clear();
+      emit statusMessage(tr("Disconnected"), 0);
+      if (this->_reconnectWhenClosed)
+        {
+          this->_reconnectWhenClosed = false;
+          connect();
+        }
+      break;
+    default:;
+    }
+  emit stateChanged(state);
+}
+
+void    Network::handleSocketError(const QString& message)
+{
+  Q_UNUSED(message);
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::handleSocketError]"
+           << message
+           << "Retries:" << this->_retries + 1;
+#endif
+  this->_retries += 1;
+  if (this->_retries < MAX_RETRIES)
+    {
+      // Exponential backoff, half of it random so that clients dropped
+      // together do not come back together.
+      const int delay = qMin(RECONNECTION_TIME << (this->_retries - 1),
+                             MAX_RECONNECTION_TIME);
+      const int jittered = delay / 2 + qrand() % (delay / 2 + 1);
+      this->_reconnectionTimer.start(jittered);
+      emit statusMessage(tr("Reconnecting in %1 seconds...")
+                         .arg((jittered + 999) / 1000), 0);
+    }
+  else
+    {
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Network::handleSocketError]"
+               << "We are stopping connection retries.";
+#endif
+      emit reconnectionAbandoned();
+    }
+}
+
+// Called once per batch parsed by the I/O thread.
+void    Network::drainEvents(void)
+{
+  NetsoulEvent event;
+
+  // Acknowledge first: a batch pushed while draining wakes us up again.
+  this->_worker->acknowledgeEvents();
+  while (this->_worker->nextEvent(event))
+    dispatch(event);
+}
+
+// Events that did not come from the socket: trace replay.
+void    Network::dispatchEvents(const QList<NetsoulEvent>& events)
+{
+  for (int i = 0; i < events.size(); ++i)
+    dispatch(events.at(i));
+}
+
+void    Network::dispatch(const NetsoulEvent& event)
+{
+  switch (event.type)
+    {
+    case NetsoulEvent::HandShakingEvent:
+      if (Protocol::WaitingSalut == event.step)
+        reachLoginPhase(SalutReceived);
+      else if (Protocol::WaitingLogReply == event.step)
+        reachLoginPhase(Authenticated);
+      processHandShaking(event);
+      break;
+    case NetsoulEvent::MsgEvent:
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Network::dispatch]"
+               << "Message received from"
+               << event.login << ":" << event.message;
+#endif
+      {
+        QString message;
+        if (this->_fragments.reassemble(QString::number(event.id) + ':' +
+                                        event.login, event.message, message))
+          emit msg(event, message);
+      }
+      break;
+    case NetsoulEvent::StateEvent: emit state(event); break;
+    case NetsoulEvent::WhoEvent:
+      reachLoginPhase(FirstWho);
+      emit who(event);
+      break;
+    case NetsoulEvent::WhoEndEvent:
+      reachLoginPhase(FirstWho);
+      handleWhoEnd();
+      break;
+    case NetsoulEvent::TypingEvent:
+      emit typingStatus(event.id, event.typing);
+      break;
+    case NetsoulEvent::RepEvent: handleRep(); break;
+    }
+}
+
+void    Network::scheduleFlush(const int msecs)
+{
+  if (this->_flushTimer.isActive() &&
+      this->_flushTimer.remainingTime() <= msecs)
+    return;
+  this->_flushTimer.start(msecs);
+}
+
+// One write, hence one syscall on the I/O thread, per tick.
+// Whatever the bucket or the socket cannot take yet stays queued,
+// where later typing/state notifications replace it.
+void    Network::flushTyping(void)
+{
+  QList<TypingShaper::Notification> due;
+  const int next = this->_typing.poll(due);
+  for (int i = 0; i < due.size(); ++i)
+    {
+      QByteArray typingStatus(due.at(i).destination);
+      if (due.at(i).typing)
+        typingStatus += " dotnetSoul_UserTyping null\n";
+      else
+        typingStatus += " dotnetSoul_UserCancelledTyping null\n";
+      this->_outbound.append(typingStatus, OutboundQueue::Typing,
+                             due.at(i).key);
+    }
+  if (!due.isEmpty())
+    scheduleFlush();
+  if (next >= 0)
+    this->_typingTimer.start(next);
+  else
+    this->_typingTimer.stop();
+}
+
+void    Network::flush(void)
+{
+  if (this->_outbound.isEmpty())
+    return;
+  int budget = this->_bucket.available();
+  if (this->_worker->bytesToWrite() > HIGH_WATERMARK)
+    budget = 0;
+  QList<int> whoChunks;
+  QList<qint64> messages;
+  int spent = 0;
+  const QByteArray batch =
+    this->_outbound.take(budget,
+                         this->_maxWhoInFlight - this->_whoInFlight.size(),
+                         &whoChunks, &messages, &spent);
+  if (!whoChunks.isEmpty() && !this->_sweep.isValid())
+    {
+      this->_sweep.start();
+      this->_sweepChunks = 0;
+      this->_sweepLogins = 0;
+    }
+  for (int i = 0; i < whoChunks.size(); ++i)
+    {
+      WhoChunk chunk;
+      chunk.logins = whoChunks.at(i);
+      chunk.sent.start();
+      this->_whoInFlight.enqueue(chunk);
+    }
+  if (!batch.isEmpty())
+    {
+      // Critical commands, pings included, are always taken
+      const qint64 now = this->_clock.nsecsElapsed();
+      const bool lonePing = (1 == this->_pingsQueued && "ping\n" == batch);
+      if (lonePing && isQuiet(now))
+        this->_pingSent = now;
+      else
+        {
+          this->_pingSent = -1;
+          this->_lastCommand = now;
+        }
+      if (this->_pingsQueued > 0 && !isPingWaiting())
+        this->_pingWaiting = now;
+    }
+  this->_pingsQueued = 0;
+  this->_bytesSent += batch.size();
+  // Taken before logging in, they are replayed once logged in
+  for (int i = 0; i < messages.size() && this->_outboxOpen; ++i)
+    this->_messagesInFlight.enqueue(qMakePair(messages.at(i),
+                                              this->_bytesSent));
+  if (!batch.isEmpty())
+    {
+      // Critical commands do not put the bucket in debt
+      this->_bucket.consume(spent);
+      QMetaObject::invokeMethod(this->_worker, "write", Qt::QueuedConnection,
+                                Q_ARG(QByteArray, batch));
+    }
+  if (!this->_outbound.isEmpty())
+    {
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Network::flush] queue depth:" << this->_outbound.size();
+#endif
+      scheduleFlush(qMax(this->_bucket.msecsUntilAvailable(),
+                         BACKPRESSURE_DELAY));
+    }
+}
+
+// Matches a who reply with the oldest chunk in flight.
+void    Network::handleWhoEnd(void)
+{
+  if (this->_whoInFlight.isEmpty())
+    return;
+  const WhoChunk chunk = this->_whoInFlight.dequeue();
+  const qint64 latency = chunk.sent.elapsed();
+  ++this->_sweepChunks;
+  this->_sweepLogins += chunk.logins;
+  emit whoChunkAnswered(chunk.logins, latency);
+  if (this->_whoInFlight.isEmpty() && 0 == this->_outbound.pendingWho())
+    {
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Network::handleWhoEnd] sweep of"
+               << this->_sweepLogins << "logins in"
+               << this->_sweepChunks << "chunks took"
+               << this->_sweep.elapsed() << "ms";
+#endif
+      emit sweepFinished(this->_sweepChunks, this->_sweepLogins,
+                         this->_sweep.elapsed());
+      this->_sweep.invalidate();
+    }
+  else if (this->_outbound.pendingWho() > 0)
+    scheduleFlush(); // a slot is free for the next chunk
+}
+
+// The server answers "rep 002 -- cmd end" to watch_log_user, msg_user
+// and ping lines but not to state, see OutboundQueue.h. Rather than
+// relying on that list, which may differ between servers, only
+// a ping written alone on a quiet connection is timed: nothing else
+// awaits a reply then, so the first rep that follows is its own.
+// Anything written after it voids the sample (flush()), our answers to
+// server pings included: they read "ping" too.
+void    Network::handleRep(void)
+{
+  if (this->_pingSent < 0)
+    return;
+  const qint64 rtt = (this->_clock.nsecsElapsed() - this->_pingSent) / 1000;
+  const qint64 reply = this->_worker->msecsSinceLastReply();
+  this->_pingSent = -1;
+  if (reply >= 0 && reply * 1000 < rtt)
+    return;
+  this->_pingLatency.record(rtt);
+  emit pingAnswered(rtt);
+}
+
+// No timed ping nor who chunk awaits a reply, and whatever else was
+// written, here or by the worker, had REPLY_SETTLE to be answered.
+bool    Network::isQuiet(const qint64 now) const
+{
+  const qint64 reply = this->_worker->msecsSinceLastReply();
+  return this->_pingSent < 0 && this->_whoInFlight.isEmpty() &&
+    (this->_lastCommand < 0 ||
+     (now - this->_lastCommand) / 1000000 >= REPLY_SETTLE) &&
+    (reply < 0 || reply >= REPLY_SETTLE);
+}
+
+// A session is dead when its login outlasts the deadline, or when a
+// ping stayed unanswered that long while nothing else came either.
+// Any inbound byte counts as an answer, so this holds whether the
+// server answers pings or not, and before any ping was timed.
+void    Network::checkLiveness(void)
+{
+  const int deadline = this->_options.pingDeadline;
+  if (deadline <= 0 || QAbstractSocket::ConnectedState != state())
+    return;
+
+  bool dead = false;
+  if (!this->_pingTimer.isActive())
+    dead = this->_loginClock.elapsed() >= deadline;
+  else if (isPingWaiting())
+    dead = (this->_clock.nsecsElapsed() - this->_pingWaiting) / 1000000 >=
+      deadline;
+  if (dead)
+    handleDeadPeer();
+}
+
+// A ping was written and nothing was received since
+bool    Network::isPingWaiting(void) const
+{
+  if (this->_pingWaiting < 0)
+    return false;
+  const qint64 silence = inboundAge();
+  return silence < 0 ||
+    silence * 1000000 >= this->_clock.nsecsElapsed() - this->_pingWaiting;
+}
+
+// Aborted rather than closed: a dead peer would never acknowledge the
+// pending writes. The connection is attempted again once closed.
+void    Network::handleDeadPeer(void)
+{
+  const qint64 silence = qMax(qint64(0), inboundAge());
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::handleDeadPeer] nothing received for"
+           << silence << "ms";
+#endif
+  if (this->_endpoint >= 0)
+    adjustScore(this->_attempts.indexOf(this->_endpoint),
+                -DEAD_PEER_PENALTY);
+  this->_failover.start();
+  emit statusMessage(tr("Server silent for %1 ms, reconnecting...")
+                     .arg(silence), 0);
+  emit reconnecting();
+  disconnect();
+  this->_reconnectWhenClosed = true;
+  QMetaObject::invokeMethod(this->_worker, "abort", Qt::QueuedConnection);
+}
+
+void    Network::handleEndpointConnected(int attempt, const QString& address)
+{
+  if (attempt < 0 || attempt >= this->_attempts.size())
+    return;
+  this->_endpoint = this->_attempts.at(attempt);
+  this->_hosts.store(this->_endpoints.at(this->_endpoint).host, address);
+  adjustScore(attempt, 1);
+}
+
+// Resolved again next time, the cached address may be the stale part.
+void    Network::handleEndpointFailed(int attempt)
+{
+  if (attempt < 0 || attempt >= this->_attempts.size())
+    return;
+  this->_hosts.forget(this->_endpoints.at(this->_attempts.at(attempt)).host);
+  adjustScore(attempt, -1);
+}
+
+void    Network::adjustScore(const int attempt, const int delta)
+{
+  if (attempt < 0 || attempt >= this->_attempts.size())
+    return;
+  int& score = this->_endpoints[this->_attempts.at(attempt)].score;
+  score = qBound(MIN_SCORE, score + delta, MAX_SCORE);
+}
+
+qint64  Network::inboundAge(void) const
+{
+  return this->_worker->msecsSinceLastInbound();
+}
+
+QJsonObject     Network::statistics(void) const
+{
+  static const char* const phases[LoginPhaseCount] =
+    { "tcpConnect", "salutReceived", "authenticated", "firstWho" };
+  QJsonObject login;
+  for (int i = 0; i < LoginPhaseCount; ++i)
+    login[phases[i]] = static_cast<double>(this->_loginPhases[i]);
+
+  QJsonObject json;
+  json["login"] = this->_options.login;
+  json["server"] = this->_options.server;
+  json["state"] = static_cast<int>(state());
+  json["queueDepth"] = queueDepth();
+  json["inboundAge"] = static_cast<double>(inboundAge());
+  json["loginPhases"] = login;
+  json["ping"] = this->_pingLatency.toJson();
+  QJsonObject typing;
+  typing["sent"] = static_cast<double>(this->_typing.sent());
+  typing["suppressed"] = static_cast<double>(this->_typing.suppressed());
+  typing["expired"] = static_cast<double>(this->_typing.expired());
+  json["typing"] = typing;
+  return json;
+}
+
+// Each phase is recorded once per connection, in order.
+void    Network::reachLoginPhase(const LoginPhase phase)
+{
+  if (this->_loginPhases[phase] >= 0 || !this->_loginClock.isValid() ||
+      (phase > TcpConnect && this->_loginPhases[phase - 1] < 0))
+    return;
+  this->_loginPhases[phase] = this->_loginClock.elapsed();
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::reachLoginPhase]" << phase
+           << this->_loginPhases[phase] << "ms";
+#endif
+  emit loginPhaseReached(phase, this->_loginPhases[phase]);
+}
+
+void    Network::ping(void)
+{
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Network::ping] Pingin'...";
+#endif
+  ++this->_pingsQueued;
+  sendMessage("ping\n");
+}
+
+// Everything ext_user_log needs but the server challenge is known
+// before connecting, so it stays off the handshake critical path.
+// Only a %L location waits for the local address.
+void    Network::prepareLogin(void)
+{
+  const QString& location = this->_options.location;
+  const QString comment = this->_options.comment.isEmpty() ?
+    Tools::defaultComment() : this->_options.comment;
+
+  this->_loginName = this->_options.login.toUtf8();
+  this->_loginPassword = this->_options.password.toUtf8();
+  this->_resolveLocation = (location.isEmpty() || location.contains("%L"));
+  if (!this->_resolveLocation)
+    this->_loginLocation =
+      url_encode(location.toStdString().c_str()).toUtf8();
+  this->_loginComment = url_encode(comment.toStdString().c_str()).toUtf8();
+}
+
+// auth_ag and ext_user_log leave together on salut, then state and
+// whatever the handShaking() receivers queue (watch_log_user, who)
+// leave together on the log reply: two round trips from salut to a
+// populated tree.
+void    Network::processHandShaking(const NetsoulEvent& event)
+{
+  switch (event.step)
+    {
+    case Protocol::WaitingSalut:
+      {
+        const QStringList& args = event.args;
+        if (this->_loginPassword.isEmpty() || args.size() <= 5)
+          break;
+        if (this->_resolveLocation)
+          {
+            QString location(this->_options.location);
+            resolveLocation(location);
+            this->_loginLocation =
+              url_encode(location.toStdString().c_str()).toUtf8();
+          }
+        sendMessage(Protocol::loginCommands(args, this->_loginName,
+                                            this->_loginPassword,
+                                            this->_loginLocation,
+                                            this->_loginComment));
+        break;
+      }
+    case Protocol::WaitingLogReply:
+      {
+        QByteArray state("state actif:");
+        state.append(QString::number(static_cast<uint>
+                                     (QDateTime::currentDateTime()
+                                      .toTime_t())));
+        state.append('\n');
+        sendMessage(state);
+        this->_pingTimer.start(this->_options.pingInterval);
+        openOutbox();
+        if (this->_failover.isValid() && this->_endpoint >= 0)
+          {
+            emit statusMessage(tr("Failed over to %1 in %2 ms.")
+                               .arg(this->_endpoints.at(this->_endpoint).host)
+                               .arg(this->_failover.elapsed()), 0);
+            this->_failover.invalidate();
+          }
+        else
+          emit statusMessage(tr("You are now NetSouled."), 2000);
+        break;
+      }
+    case -1:
+      disconnect();
+      emit statusMessage(tr("Authentification failed."), 0);
+      break;
+    default:;
+    }
+  emit handShaking(event.step, event.args);
+}
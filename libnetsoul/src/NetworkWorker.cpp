@@ -0,0 +1,371 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QNetworkProxy>
+#ifdef Q_OS_LINUX
+# include <unistd.h>
+# include <sys/socket.h>
+#endif
+#include "NetworkWorker.h"
+
+namespace
+{
+  // How long detach() waits for the pending writes, in milliseconds
+  const int DETACH_TIMEOUT = 3000;
+}
+
+NetworkWorker::NetworkWorker(void)
+  : _socket(NULL),
+    _notified(0), _socketState(QAbstractSocket::UnconnectedState),
+    _bytesToWrite(0), _bytesWritten(0), _bytesQueued(0), _replyBytes(0),
+    _lastInbound(-1), _lastReply(-1),
+    _detached(-1), _silent(-1)
+{
+  this->_clock.start();
+  adopt(createSocket());
+}
+
+// Sockets are children: they follow the worker to the I/O thread.
+QTcpSocket*     NetworkWorker::createSocket(void)
+{
+  QTcpSocket* socket = new QTcpSocket(this);
+  socket->setProxy(QNetworkProxy::NoProxy);
+  return socket;
+}
+
+void    NetworkWorker::adopt(QTcpSocket* socket)
+{
+  if (this->_socket)
+    {
+      this->_socket->disconnect(this);
+      this->_socket->deleteLater();
+    }
+  this->_socket = socket;
+  this->_bytesWritten = 0;
+  this->_bytesQueued = 0;
+  this->_replyBytes = 0;
+  this->_replyOffsets.clear();
+  QObject::connect(this->_socket, SIGNAL(readyRead()),
+                   SLOT(processPackets()));
+  QObject::connect(this->_socket, SIGNAL(bytesWritten(qint64)),
+                   SLOT(countBytesWritten(qint64)));
+  QObject::connect(this->_socket,
+                   SIGNAL(stateChanged(QAbstractSocket::SocketState)),
+                   SLOT(handleSocketState(QAbstractSocket::SocketState)));
+  QObject::connect(this->_socket,
+                   SIGNAL(error(QAbstractSocket::SocketError)),
+                   SLOT(handleSocketError(QAbstractSocket::SocketError)));
+}
+
+QAbstractSocket::SocketState    NetworkWorker::socketState(void) const
+{
+  return static_cast<QAbstractSocket::SocketState>
+    (this->_socketState.loadAcquire());
+}
+
+// Empty path stops capturing. A capture spans reconnections.
+void    NetworkWorker::setCapture(const QString& path)
+{
+  if (path.isEmpty())
+    this->_trace.close();
+  else if (!this->_trace.isOpen() && !this->_trace.open(path))
+    qWarning("[NetworkWorker::setCapture] cannot write %s",
+             qPrintable(path));
+}
+
+qint64  NetworkWorker::msecsSinceLastInbound(void) const
+{
+  const qint64 last = this->_lastInbound.loadAcquire();
+  return last < 0 ? -1 : this->_clock.elapsed() - last;
+}
+
+qint64  NetworkWorker::msecsSinceLastReply(void) const
+{
+  const qint64 last = this->_lastReply.loadAcquire();
+  return last < 0 ? -1 : this->_clock.elapsed() - last;
+}
+
+void    NetworkWorker::connectToEndpoints(const QStringList& endpoints)
+{
+  if (QAbstractSocket::UnconnectedState != this->_socket->state() ||
+      !this->_attempts.isEmpty() || endpoints.isEmpty())
+    {
+#ifndef QT_NO_DEBUG
+      qDebug() << "[NetworkWorker::connectToEndpoints] state:"
+               << this->_socket->state()
+               << "attempts:" << this->_attempts.size();
+#endif
+      return;
+    }
+  handleSocketState(QAbstractSocket::ConnectingState);
+  for (int i = 0; i < endpoints.size(); ++i)
+    {
+      QTcpSocket* socket = createSocket();
+      QObject::connect(socket, SIGNAL(connected()),
+                       SLOT(attemptConnected()));
+      QObject::connect(socket, SIGNAL(error(QAbstractSocket::SocketError)),
+                       SLOT(attemptFailed(QAbstractSocket::SocketError)));
+      this->_attempts.insert(socket, i);
+      socket->connectToHost(endpoints.at(i).section(' ', 0, 0),
+                            endpoints.at(i).section(' ', 1, 1).toUShort());
+    }
+}
+
+// First come, first served: the others are dropped.
+void    NetworkWorker::attemptConnected(void)
+{
+  QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+  if (!this->_attempts.contains(socket))
+    return;
+  const int index = this->_attempts.take(socket);
+  abortAttempts();
+  socket->disconnect(this);
+  adopt(socket);
+  this->_protocol.reset();
+  emit endpointConnected(index, socket->peerAddress().toString());
+  handleSocketState(QAbstractSocket::ConnectedState);
+  if (socket->bytesAvailable() > 0)
+    processPackets();
+}
+
+// The session only fails once every attempt has.
+void    NetworkWorker::attemptFailed(QAbstractSocket::SocketError error)
+{
+  Q_UNUSED(error);
+  QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+  if (!this->_attempts.contains(socket))
+    return;
+  emit endpointFailed(this->_attempts.take(socket));
+  const QString message = socket->errorString();
+  socket->disconnect(this);
+  socket->deleteLater();
+  if (this->_attempts.isEmpty())
+    {
+      handleSocketState(QAbstractSocket::UnconnectedState);
+      emit socketError(message);
+    }
+}
+
+void    NetworkWorker::abortAttempts(void)
+{
+  QHash<QTcpSocket*, int>::const_iterator it = this->_attempts.constBegin();
+  for (; it != this->_attempts.constEnd(); ++it)
+    {
+      it.key()->disconnect(this);
+      it.key()->abort();
+      it.key()->deleteLater();
+    }
+  this->_attempts.clear();
+}
+
+void    NetworkWorker::disconnectFromHost(void)
+{
+  const bool connecting = !this->_attempts.isEmpty();
+  abortAttempts();
+  this->_protocol.reset();
+  this->_socket->disconnectFromHost();
+  if (connecting)
+    handleSocketState(QAbstractSocket::UnconnectedState);
+}
+
+void    NetworkWorker::abort(void)
+{
+  const bool connecting = !this->_attempts.isEmpty();
+  abortAttempts();
+  this->_protocol.reset();
+  this->_socket->abort();
+  if (connecting)
+    handleSocketState(QAbstractSocket::UnconnectedState);
+}
+
+void    NetworkWorker::write(const QByteArray& data)
+{
+  const qint64 size = this->_socket->write(data);
+  if (size > 0)
+    this->_bytesQueued += size;
+  updateBytesToWrite();
+}
+
+void    NetworkWorker::close(void)
+{
+  abortAttempts();
+  this->_socket->close();
+#ifdef Q_OS_LINUX
+  if (this->_silent >= 0)
+    ::close(this->_silent);
+  this->_silent = -1;
+#endif
+}
+
+// The descriptor is duplicated for detachedDescriptor() and the
+// original one is pointed at a silent socket pair: this QTcpSocket can
+// neither read the session any more nor end it when it closes.
+// Everything written must have left first, a line cut in two would
+// reach the server with the new process' bytes after it. The session
+// stays here, detachedDescriptor() at -1, when that takes too long.
+QByteArray      NetworkWorker::detach(void)
+{
+  this->_detached = -1;
+#ifndef Q_OS_LINUX
+  return QByteArray();
+#else
+  abortAttempts();
+  QElapsedTimer clock;
+  clock.start();
+  while (this->_socket->bytesToWrite() > 0 &&
+         clock.elapsed() < DETACH_TIMEOUT &&
+         this->_socket->waitForBytesWritten(DETACH_TIMEOUT -
+                                            clock.elapsed()))
+    ;
+  const int fd = static_cast<int>(this->_socket->socketDescriptor());
+  if (this->_socket->bytesToWrite() > 0 || fd < 0)
+    return QByteArray();
+  int pair[2];
+  if (0 != ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair))
+    return QByteArray();
+  this->_detached = ::dup(fd);
+  if (this->_detached < 0 || ::dup2(pair[0], fd) < 0)
+    {
+      if (this->_detached >= 0)
+        ::close(this->_detached);
+      this->_detached = -1;
+      ::close(pair[0]);
+      ::close(pair[1]);
+      return QByteArray();
+    }
+  ::close(pair[0]);
+  this->_silent = pair[1];
+  QByteArray unread = this->_protocol.buffer().unread();
+  unread.append(this->_socket->readAll());
+  this->_protocol.reset();
+  this->_socket->disconnect(this);
+  this->_socketState.storeRelease(QAbstractSocket::UnconnectedState);
+  return unread;
+#endif
+}
+
+// unread is parsed before anything read from fd.
+void    NetworkWorker::resume(int fd, const QByteArray& unread)
+{
+#ifndef Q_OS_LINUX
+  Q_UNUSED(fd);
+  Q_UNUSED(unread);
+#else
+  abortAttempts();
+  QTcpSocket* socket = createSocket();
+  if (!socket->setSocketDescriptor(fd, QAbstractSocket::ConnectedState))
+    {
+      const QString message = socket->errorString();
+      ::close(fd);
+      socket->deleteLater();
+      handleSocketState(QAbstractSocket::UnconnectedState);
+      emit socketError(message);
+      return;
+    }
+  adopt(socket);
+  this->_protocol.resume();
+  this->_protocol.buffer().append(unread.constData(), unread.size());
+  handleSocketState(QAbstractSocket::ConnectedState);
+  parseBuffered();
+  if (socket->bytesAvailable() > 0)
+    processPackets();
+#endif
+}
+
+void    NetworkWorker::processPackets(void)
+{
+  const qint64 size = this->_protocol.buffer().readFrom(this->_socket);
+  if (size <= 0)
+    return;
+  this->_lastInbound.storeRelease(this->_clock.elapsed());
+  if (this->_trace.isOpen())
+    this->_trace.write(this->_protocol.buffer()
+                       .received(static_cast<int>(size)));
+  parseBuffered();
+}
+
+void    NetworkWorker::parseBuffered(void)
+{
+  if (this->_protocol.parseLines(this->_batch, this->_replies) > 0)
+    {
+      // Pings are answered right away, whatever the GUI is doing.
+      if (!this->_replies.isEmpty())
+        {
+          const qint64 size = this->_socket->write(this->_replies);
+          if (size > 0)
+            {
+              this->_replyOffsets.enqueue(qMakePair(this->_bytesQueued,
+                                                    static_cast<int>(size)));
+              this->_bytesQueued += size;
+            }
+          this->_lastReply.storeRelease(this->_clock.elapsed());
+          this->_replies.clear();
+        }
+      const int size = this->_batch.size();
+      for (int i = 0; i < size; ++i)
+        this->_events.push(this->_batch.at(i));
+      this->_batch.clear();
+      // One wake up per batch, until the GUI acknowledges it.
+      if (size > 0 && this->_notified.testAndSetOrdered(0, 1))
+        emit eventsReady();
+    }
+}
+
+// Published for Network's backpressure.
+void    NetworkWorker::updateBytesToWrite(void)
+{
+  this->_bytesToWrite.storeRelease
+    (static_cast<int>(this->_socket->bytesToWrite()));
+}
+
+void    NetworkWorker::countBytesWritten(qint64 bytes)
+{
+  this->_bytesWritten += bytes;
+  updateBytesToWrite();
+  // Ping replies share the stream with Network's batches: Network only
+  // counts its own bytes, so the replies written are taken out.
+  qint64 replies = this->_replyBytes;
+  while (!this->_replyOffsets.isEmpty())
+    {
+      const QPair<qint64, int>& reply = this->_replyOffsets.head();
+      if (reply.first + reply.second <= this->_bytesWritten)
+        {
+          this->_replyBytes += reply.second;
+          replies = this->_replyBytes;
+          this->_replyOffsets.dequeue();
+        }
+      else
+        {
+          if (reply.first < this->_bytesWritten)
+            replies += this->_bytesWritten - reply.first;
+          break;
+        }
+    }
+  emit bytesWritten(this->_bytesWritten - replies);
+}
+
+void    NetworkWorker::handleSocketState(QAbstractSocket::SocketState state)
+{
+  this->_socketState.storeRelease(state);
+  emit stateChanged(state, this->_socket->localAddress().toString());
+}
+
+void    NetworkWorker::handleSocketError(QAbstractSocket::SocketError error)
+{
+  Q_UNUSED(error);
+  emit socketError(this->_socket->errorString());
+}
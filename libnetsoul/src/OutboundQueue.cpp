@@ -0,0 +1,220 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include "OutboundQueue.h"
+
+OutboundQueue::OutboundQueue(void) : _size(0), _chunkBudget(1024)
+{
+}
+
+void    OutboundQueue::append(const QByteArray& command,
+                              const Priority priority,
+                              const QString& key,
+                              const qint64 tag)
+{
+  QList<Entry>& entries = this->_entries[priority];
+
+  if (!key.isEmpty())
+    for (int i = 0; i < entries.size(); ++i)
+      if (key == entries.at(i).key)
+        {
+          entries[i].command = command;
+          entries[i].tag = tag;
+          return;
+        }
+  Entry entry;
+  entry.kind = Raw;
+  entry.command = command;
+  entry.key = key;
+  entry.tag = tag;
+  entries.append(entry);
+  ++this->_size;
+}
+
+void    OutboundQueue::appendWho(const QString& login)
+{
+  appendTarget(Who, this->_who, login);
+}
+
+void    OutboundQueue::appendWho(const QStringList& logins)
+{
+  const int size = logins.size();
+  for (int i = 0; i < size; ++i)
+    appendTarget(Who, this->_who, logins.at(i));
+}
+
+void    OutboundQueue::appendWatch(const QString& login)
+{
+  appendTarget(Watch, this->_watch, login);
+}
+
+void    OutboundQueue::appendWatch(const QStringList& logins)
+{
+  const int size = logins.size();
+  for (int i = 0; i < size; ++i)
+    appendTarget(Watch, this->_watch, logins.at(i));
+}
+
+// Builds a batch, ready for a single write().
+// Critical commands are always taken, the other classes are taken in
+// priority order while budget bytes remain (the last one may overrun).
+// At most whoSlots who chunks are taken (-1: no limit), the number of
+// logins of each one is appended to whoChunks, and the tags of the
+// tagged commands taken to tags. watch_log_user lines are chunked but
+// not reported: their rep 002 is not matched, see OutboundQueue.h.
+// spent, if any, is set to the bytes taken out of the budget, critical
+// commands excluded.
+QByteArray      OutboundQueue::take(const int budget, const int whoSlots,
+                                    QList<int>* whoChunks,
+                                    QList<qint64>* tags, int* spent)
+{
+  QByteArray out;
+  int charged = 0;
+  int slots = whoSlots;
+
+  for (int priority = Critical; priority < PriorityCount; ++priority)
+    {
+      QList<Entry>& entries = this->_entries[priority];
+      int i = 0;
+      while (i < entries.size() && (Critical == priority || charged < budget))
+        {
+          const int before = out.size();
+          bool done = true;
+          switch (entries.at(i).kind)
+            {
+            case Raw:
+              out.append(entries.at(i).command);
+              if (tags && entries.at(i).tag >= 0)
+                tags->append(entries.at(i).tag);
+              break;
+            case Who:
+              if (0 != slots)
+                {
+                  const int taken =
+                    takeChunks(out, "user_cmd who ", this->_who,
+                               slots, budget - charged, whoChunks);
+                  if (slots > 0)
+                    slots -= taken;
+                }
+              done = this->_who.logins.isEmpty();
+              break;
+            case Watch:
+              takeChunks(out, "user_cmd watch_log_user ", this->_watch,
+                         -1, budget - charged, NULL);
+              done = this->_watch.logins.isEmpty();
+              break;
+            }
+          if (Critical != priority)
+            charged += out.size() - before;
+          if (done)
+            {
+              entries.removeAt(i);
+              --this->_size;
+            }
+          else // waiting for budget or who slots, let the others go
+            ++i;
+        }
+    }
+  if (spent)
+    *spent = charged;
+  return out;
+}
+
+void    OutboundQueue::clear(void)
+{
+  for (int priority = Critical; priority < PriorityCount; ++priority)
+    this->_entries[priority].clear();
+  this->_size = 0;
+  this->_who = Targets();
+  this->_watch = Targets();
+}
+
+void    OutboundQueue::appendTarget(const Kind kind,
+                                    Targets& targets,
+                                    const QString& login)
+{
+  if (login.isEmpty() || targets.seen.contains(login))
+    return;
+  if (!targets.queued)
+    {
+      Entry entry;
+      entry.kind = kind;
+      entry.tag = -1;
+      targets.queued = true;
+      this->_entries[Presence].append(entry);
+      ++this->_size;
+    }
+  targets.seen.insert(login);
+  targets.logins.append(login);
+}
+
+// Cuts the pending targets into lines of at most _chunkBudget bytes
+// (a single login always makes a line) until budget bytes or maxChunks
+// lines are taken. Returns the number of lines.
+int     OutboundQueue::takeChunks(QByteArray& out, const char* command,
+                                  Targets& targets, const int maxChunks,
+                                  const int budget, QList<int>* chunks)
+{
+  // command, braces and '\n'
+  const int overhead = static_cast<int>(strlen(command)) + 3;
+  int spent = 0;
+  int count = 0;
+
+  while (!targets.logins.isEmpty() && count != maxChunks &&
+         (0 == count || spent < budget))
+    {
+      QStringList chunk;
+      int bytes = overhead;
+      while (!targets.logins.isEmpty())
+        {
+          const QString& login = targets.logins.first();
+          const int size = login.size() + 1;
+          if (!chunk.isEmpty() && bytes + size > this->_chunkBudget)
+            break;
+          bytes += size;
+          targets.seen.remove(login);
+          chunk.append(targets.logins.takeFirst());
+        }
+      const int before = out.size();
+      appendBraceList(out, command, chunk);
+      spent += out.size() - before;
+      if (chunks)
+        chunks->append(chunk.size());
+      ++count;
+    }
+  if (targets.logins.isEmpty())
+    targets.queued = false;
+  return count;
+}
+
+void    OutboundQueue::appendBraceList(QByteArray& out,
+                                       const char* command,
+                                       const QStringList& logins)
+{
+  const int size = logins.size();
+
+  out.append(command);
+  if (size > 1) out.append('{');
+  for (int i = 0; i < size; ++i)
+    {
+      if (i > 0) out.append(',');
+      out.append(logins.at(i).toUtf8());
+    }
+  if (size > 1) out.append('}');
+  out.append('\n');
+}
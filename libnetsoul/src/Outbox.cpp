@@ -0,0 +1,206 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDebug>
+#ifdef Q_OS_UNIX
+# include <unistd.h>
+#endif
+#ifdef Q_OS_WIN
+# include <io.h>
+#endif
+#include "Outbox.h"
+
+namespace
+{
+  const char MAGIC[] = "NSOUTBX1";
+  const int  MAGIC_SIZE = 8;
+
+  bool  readVarint(const QByteArray& data, int& pos, quint64& value)
+  {
+    value = 0;
+    for (int shift = 0; pos < data.size() && shift < 64; shift += 7)
+      {
+        const quint8 byte = static_cast<quint8>(data.at(pos++));
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          return true;
+      }
+    return false;
+  }
+
+  void  appendVarint(QByteArray& out, quint64 value)
+  {
+    do
+      {
+        char byte = static_cast<char>(value & 0x7f);
+        value >>= 7;
+        if (value)
+          byte |= 0x80;
+        out.append(byte);
+      }
+    while (value);
+  }
+}
+
+bool    Outbox::open(const QString& path)
+{
+  if (this->_file.isOpen())
+    this->_file.close();
+  if (path.isEmpty())
+    return true;
+  this->_file.setFileName(path);
+  if (!this->_file.open(QIODevice::ReadWrite))
+    {
+      this->_error = this->_file.errorString();
+      return false;
+    }
+  if (!load())
+    {
+      this->_file.close();
+      return false;
+    }
+  rewrite();
+  return true;
+}
+
+qint64  Outbox::append(const QByteArray& command)
+{
+  Message message;
+  message.seq = this->_next++;
+  message.command = command;
+  this->_pending.append(message);
+  writeRecord('M', message);
+  sync();
+  return message.seq;
+}
+
+void    Outbox::acknowledge(const qint64 seq)
+{
+  for (int i = 0; i < this->_pending.size(); ++i)
+    if (seq == this->_pending.at(i).seq)
+      {
+        writeRecord('A', this->_pending.at(i));
+        this->_pending.removeAt(i);
+        break;
+      }
+  if (this->_pending.isEmpty() && this->_file.isOpen() &&
+      this->_file.size() > MAGIC_SIZE)
+    rewrite();
+}
+
+bool    Outbox::isPending(const qint64 seq) const
+{
+  for (int i = 0; i < this->_pending.size(); ++i)
+    if (seq == this->_pending.at(i).seq)
+      return true;
+  return false;
+}
+
+// Messages of the journal not acknowledged, appended to the ones
+// already pending in memory.
+bool    Outbox::load(void)
+{
+  const QByteArray data = this->_file.readAll();
+  if (data.isEmpty())
+    return true;
+  if (data.size() < MAGIC_SIZE || !data.startsWith(MAGIC))
+    {
+      this->_error = QObject::tr("not an outbox journal");
+      return false;
+    }
+  QList<Message> journal;
+  int pos = MAGIC_SIZE;
+  while (pos < data.size())
+    {
+      const char type = data.at(pos++);
+      quint64 seq, size;
+      if (!readVarint(data, pos, seq))
+        break;
+      if ('A' == type)
+        {
+          for (int i = 0; i < journal.size(); ++i)
+            if (static_cast<qint64>(seq) == journal.at(i).seq)
+              {
+                journal.removeAt(i);
+                break;
+              }
+          continue;
+        }
+      if ('M' != type || !readVarint(data, pos, size) ||
+          size > static_cast<quint64>(data.size() - pos))
+        break;
+      Message message;
+      message.seq = static_cast<qint64>(seq);
+      message.command = data.mid(pos, static_cast<int>(size));
+      pos += static_cast<int>(size);
+      journal.append(message);
+    }
+#ifndef QT_NO_DEBUG
+  qDebug() << "[Outbox::load]" << journal.size() << "pending in"
+           << this->_file.fileName();
+#endif
+  // Renumbered after the ones of this run, in journal order
+  for (int i = 0; i < journal.size(); ++i)
+    {
+      journal[i].seq = this->_next++;
+      this->_pending.append(journal.at(i));
+    }
+  return true;
+}
+
+void    Outbox::rewrite(void)
+{
+  this->_file.resize(0);
+  this->_file.seek(0);
+  this->_file.write(MAGIC, MAGIC_SIZE);
+  for (int i = 0; i < this->_pending.size(); ++i)
+    writeRecord('M', this->_pending.at(i));
+  this->_file.flush();
+  sync();
+}
+
+void    Outbox::writeRecord(const char type, const Message& message)
+{
+  if (!this->_file.isOpen())
+    return;
+  QByteArray record(1, type);
+  appendVarint(record, static_cast<quint64>(message.seq));
+  if ('M' == type)
+    {
+      appendVarint(record, static_cast<quint64>(message.command.size()));
+      record.append(message.command);
+    }
+  this->_file.write(record);
+  this->_file.flush();
+}
+
+// Down to the disk, not only to the OS.
+void    Outbox::sync(void)
+{
+  const int fd = this->_file.handle();
+  int result = 0;
+  if (fd < 0)
+    return;
+#if defined(Q_OS_UNIX)
+  result = fsync(fd);
+#elif defined(Q_OS_WIN)
+  result = _commit(fd);
+#endif
+  if (result < 0)
+    qWarning("Cannot sync the outbox %s",
+             qPrintable(this->_file.fileName()));
+}
@@ -0,0 +1,153 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDateTime>
+#include <QStringList>
+#include "Network.h"
+#include "PresenceScheduler.h"
+
+namespace
+{
+  // Milliseconds
+  const int MIN_INTERVAL = 30000;
+  const int MAX_INTERVAL = 300000;
+  const qint64 STALE_AGE = 600000;
+  // Random contacts queried on each tick
+  const int SAMPLE_SIZE = 3;
+}
+
+PresenceScheduler::PresenceScheduler(Network* network)
+  : QObject(network), _network(network),
+    _interval(MIN_INTERVAL), _drift(false), _baseline(false)
+{
+  Q_ASSERT(this->_network);
+  qsrand(QDateTime::currentDateTime().toTime_t());
+  this->_timer.setSingleShot(true);
+  this->_clock.start();
+  connect(&this->_timer, SIGNAL(timeout()), SLOT(tick()));
+  connect(this->_network, SIGNAL(who(const NetsoulEvent&)),
+          SLOT(checkWho(const NetsoulEvent&)));
+  connect(this->_network, SIGNAL(state(const NetsoulEvent&)),
+          SLOT(checkState(const NetsoulEvent&)));
+  connect(this->_network, SIGNAL(msg(const NetsoulEvent&, const QString&)),
+          SLOT(checkMsg(const NetsoulEvent&, const QString&)));
+  connect(this->_network, SIGNAL(sweepFinished(int, int, qint64)),
+          SLOT(sweepFinished()));
+}
+
+// Full sweep, once per (re)connection.
+void    PresenceScheduler::start(void)
+{
+  const QStringList& logins = this->_contacts;
+
+  this->_checked.clear();
+  this->_states.clear();
+  this->_baseline = false;
+  this->_drift = false;
+  this->_interval = MIN_INTERVAL;
+  for (int i = 0; i < logins.size(); ++i)
+    touch(logins.at(i));
+  this->_network->refreshContacts(logins);
+  this->_timer.start(this->_interval);
+}
+
+void    PresenceScheduler::resume(const QList<NetsoulEvent>& snapshot)
+{
+  const QStringList& logins = this->_contacts;
+
+  this->_checked.clear();
+  this->_states.clear();
+  this->_baseline = true;
+  this->_drift = false;
+  this->_interval = MIN_INTERVAL;
+  for (int i = 0; i < snapshot.size(); ++i)
+    this->_states.insert(snapshot.at(i).id, snapshot.at(i).state);
+  for (int i = 0; i < logins.size(); ++i)
+    touch(logins.at(i));
+  this->_timer.start(this->_interval);
+}
+
+void    PresenceScheduler::stop(void)
+{
+  this->_timer.stop();
+}
+
+void    PresenceScheduler::tick(void)
+{
+  const QStringList& logins = this->_contacts;
+  const qint64 now = this->_clock.elapsed();
+  QStringList query;
+
+  for (int i = 0; i < logins.size(); ++i)
+    if (now - this->_checked.value(logins.at(i), 0) >= STALE_AGE)
+      query << logins.at(i);
+  for (int i = 0; i < SAMPLE_SIZE && !logins.isEmpty(); ++i)
+    {
+      const QString& login = logins.at(qrand() % logins.size());
+      if (!query.contains(login))
+        query << login;
+    }
+  for (int i = 0; i < query.size(); ++i)
+    touch(query.at(i));
+
+  // Missed events mean watch_log_user is not enough: look more often.
+  if (this->_drift)
+    this->_interval = qMax(MIN_INTERVAL, this->_interval / 2);
+  else
+    this->_interval = qMin(MAX_INTERVAL, this->_interval * 3 / 2);
+  this->_drift = false;
+#ifndef QT_NO_DEBUG
+  qDebug() << "[PresenceScheduler::tick]" << query.size()
+           << "contacts queried, next tick in" << this->_interval << "ms";
+#endif
+  this->_network->refreshContacts(query);
+  this->_timer.start(this->_interval);
+}
+
+void    PresenceScheduler::checkWho(const NetsoulEvent& event)
+{
+  QHash<int, int>::const_iterator it = this->_states.constFind(event.id);
+  if (this->_baseline &&
+      (this->_states.constEnd() == it || event.state != it.value()))
+    this->_drift = true;
+  this->_states.insert(event.id, event.state);
+  touch(event.login);
+}
+
+void    PresenceScheduler::checkState(const NetsoulEvent& event)
+{
+  if (NetsoulEvent::Logout == event.state)
+    this->_states.remove(event.id);
+  else
+    this->_states.insert(event.id, event.state);
+  touch(event.login);
+}
+
+void    PresenceScheduler::checkMsg(const NetsoulEvent& event, const QString&)
+{
+  touch(event.login);
+}
+
+void    PresenceScheduler::sweepFinished(void)
+{
+  this->_baseline = true;
+}
+
+void    PresenceScheduler::touch(const QString& login)
+{
+  this->_checked.insert(login, this->_clock.elapsed());
+}
@@ -0,0 +1,355 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>
+#include <QDebug>
+#include <QCryptographicHash>
+#include "Protocol.h"
+
+namespace
+{
+  // First token of every line the server sends
+  enum Command { UnknownCommand, Salut, Rep, Ping, UserCmd };
+
+  // Sub-commands of user_cmd, they index Protocol::handleUserCmd table
+  enum UserCommand { UserWho, UserMsg, UserState, UserLogin, UserLogout,
+                     UserTyping, UserCancelledTyping, UnknownUserCommand };
+
+  bool  equals(const QByteArray& token, const char* name, const int size)
+  {
+    return 0 == memcmp(token.constData(), name, size);
+  }
+
+  // Length and first letter are enough to tell commands apart,
+  // so a single memcmp confirms the match.
+  Command commandOf(const QByteArray& token)
+  {
+    switch (token.size())
+      {
+      case 3: if (equals(token, "rep", 3)) return Rep; break;
+      case 4: if (equals(token, "ping", 4)) return Ping; break;
+      case 5: if (equals(token, "salut", 5)) return Salut; break;
+      case 8: if (equals(token, "user_cmd", 8)) return UserCmd; break;
+      default:;
+      }
+    return UnknownCommand;
+  }
+
+  UserCommand userCommandOf(const QByteArray& token)
+  {
+    switch (token.size())
+      {
+      case 3:
+        if ('w' == token.at(0) && equals(token, "who", 3)) return UserWho;
+        if ('m' == token.at(0) && equals(token, "msg", 3)) return UserMsg;
+        break;
+      case 5:
+        if ('s' == token.at(0) && equals(token, "state", 5)) return UserState;
+        if ('l' == token.at(0) && equals(token, "login", 5)) return UserLogin;
+        break;
+      case 6:
+        if (equals(token, "logout", 6)) return UserLogout;
+        break;
+      case 21:
+        if (equals(token, "dotnetSoul_UserTyping", 21)) return UserTyping;
+        break;
+      case 30:
+        if (equals(token, "dotnetSoul_UserCancelledTyping", 30))
+          return UserCancelledTyping;
+        break;
+      default:;
+      }
+    return UnknownUserCommand;
+  }
+}
+
+Protocol::Protocol(void)
+  : _events(NULL), _replies(NULL), _handShakingStep(WaitingSalut)
+{
+}
+
+void    Protocol::reset(void)
+{
+  this->_handShakingStep = WaitingSalut;
+  this->_rbuffer.clear();
+}
+
+void    Protocol::resume(void)
+{
+  this->_handShakingStep = NetSouled;
+  this->_rbuffer.clear();
+}
+
+// Frames and interprets every complete line received so far.
+// Events are appended to events, automatic answers (ping) to replies.
+int     Protocol::parseLines(QList<NetsoulEvent>& events, QByteArray& replies)
+{
+  QByteArray line;
+  int lines = 0;
+
+  this->_events = &events;
+  this->_replies = &replies;
+  // Interpret each complete line, straight from the receive buffer.
+  while (this->_rbuffer.nextLine(line))
+    if (!line.isEmpty())
+      {
+        interpretLine(line);
+        ++lines;
+      }
+
+  // Decoded fields of this batch go together, then the partial line
+  // (if any) is kept for the next one.
+  this->_fields.clear();
+  this->_rbuffer.compact();
+  this->_events = NULL;
+  this->_replies = NULL;
+  return lines;
+}
+
+// salut 3 b6b2b1e7dcd0be9ed8b21e6d1e7 10.224.0.1 62404 1281146904
+// MD5 of "hash-host/port" followed by the password.
+QByteArray      Protocol::loginCommands(const QStringList& salut,
+                                        const QByteArray& login,
+                                        const QByteArray& password,
+                                        const QByteArray& location,
+                                        const QByteArray& comment)
+{
+  QByteArray sum;
+  sum.append(QString("%1-%2/%3")
+             .arg(salut.at(2)).arg(salut.at(3)).arg(salut.at(4)));
+  sum.append(password);
+  sum = QCryptographicHash::hash(sum, QCryptographicHash::Md5);
+
+  QByteArray message("auth_ag ext_user none none\n");
+  message.append("ext_user_log ");
+  message.append(login);
+  message.append(' ');
+  message.append(sum.toHex());
+  message.append(' ');
+  message.append(location);
+  message.append(' ');
+  message.append(comment);
+  message.append('\n');
+  return message;
+}
+
+// Only the first token is looked at here, each handler then
+// tokenizes what it needs. Unknown commands cost a switch.
+void    Protocol::interpretLine(const QByteArray& line)
+{
+#ifndef QT_NO_DEBUG
+  //qDebug() << line;
+#endif
+  const int space = line.indexOf(' ');
+  const QByteArray command =
+    QByteArray::fromRawData(line.constData(),
+                            space < 0 ? line.size() : space);
+
+  switch (commandOf(command))
+    {
+    case UserCmd: handleUserCmd(line); break;
+    case Ping:
+      this->_replies->append("ping\n");
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Protocol::interpretLine]"
+               << "Ping received, ping answered.";
+#endif
+      break;
+    case Rep: handleRep(line); break;
+    case Salut: handleSalut(line); break;
+    default:
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Protocol::interpretLine]"
+               << "Unparsed command:" << line;
+#endif
+      break;
+    }
+}
+
+// salut 3 b6b2b1e7dcd0be9ed8b21e6d1e7 10.224.0.1 62404 1281146904
+void    Protocol::handleSalut(const QByteArray& line)
+{
+  if (WaitingSalut != this->_handShakingStep)
+    return;
+  Tokenizer& parts = this->_tokenizer;
+  parts.tokenize(line);
+  NetsoulEvent event;
+  for (int i = 0; i < parts.size(); ++i)
+    event.args << QString::fromUtf8(parts.at(i));
+  this->_handShakingStep = WaitingAuthReply;
+  pushHandShaking(WaitingSalut, event);
+}
+
+// rep 002 -- cmd end
+// rep 033 -- ext user identification fail
+void    Protocol::handleRep(const QByteArray& line)
+{
+  if (line.startsWith("rep 002 --"))
+    {
+      switch (this->_handShakingStep)
+        {
+        case WaitingAuthReply:
+          this->_handShakingStep = WaitingLogReply;
+          pushHandShaking(WaitingAuthReply, NetsoulEvent());
+          break;
+        case WaitingLogReply:
+          this->_handShakingStep = NetSouled;
+          pushHandShaking(WaitingLogReply, NetsoulEvent());
+          break;
+        case NetSouled:
+          {
+            NetsoulEvent event;
+            push(NetsoulEvent::RepEvent, event);
+            break;
+          }
+        default:;
+        }
+    }
+  else if (line.startsWith("rep 033 --"))
+    {
+      pushHandShaking(-1, NetsoulEvent());
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Protocol::handleRep]"
+               << "Failure...\n"
+               << "Reason:" << line;
+#endif
+    }
+}
+
+// user_cmd 566:user:1/3:sundas_c@0.0.0.0:~:maison:epitech_2011 | ...
+void    Protocol::handleUserCmd(const QByteArray& line)
+{
+  struct Handler
+  {
+    int minParts;
+    bool connectionInfo; // does the handler need parseConnectionInfo ?
+    void (Protocol::*handle)(const Tokenizer&, NetsoulEvent&);
+  };
+  // Indexed by UserCommand
+  static const Handler handlers[] =
+    {
+      {5,  false, &Protocol::handleWho},
+      {5,  true,  &Protocol::handleMsg},
+      {5,  true,  &Protocol::handleState},
+      {4,  true,  &Protocol::handleLog},
+      {4,  true,  &Protocol::handleLog},
+      {4,  true,  &Protocol::handleTyping},
+      {4,  true,  &Protocol::handleTyping}
+    };
+
+  Tokenizer& parts = this->_tokenizer;
+  if (parts.tokenize(line) < 4)
+    return;
+  const UserCommand command = userCommandOf(parts.at(3));
+  if (UnknownUserCommand == command)
+    return;
+  const Handler& handler = handlers[command];
+  if (parts.size() < handler.minParts)
+    return;
+  NetsoulEvent event;
+  if (handler.connectionInfo &&
+      !event.parseConnectionInfo(parts, 1, this->_fields))
+    {
+#ifndef QT_NO_DEBUG
+      qDebug() << "[Protocol::handleUserCmd]"
+               << "Invalid connection informations:" << line;
+#endif
+      return;
+    }
+  (this->*handler.handle)(parts, event);
+}
+
+QString Protocol::field(const Tokenizer& parts, const int i)
+{
+  const Tokenizer::Field& f = parts.field(i);
+  return this->_fields.field(parts.data() + f.begin, f.end - f.begin);
+}
+
+QString Protocol::encodedField(const Tokenizer& parts, const int i)
+{
+  const Tokenizer::Field& f = parts.field(i);
+  return this->_fields.encodedField(parts.data() + f.begin,
+                                    f.end - f.begin);
+}
+
+// user_cmd 199:user:1/3:dally_r@0.0.0.0:~:maison:epitech_2011
+// | who 329 sundas_c 0.0.0.0 1281146904 1281147024 3 1 ~ maison epitech_2011 actif:1281147031 qnetsoul
+// Each who command ends with:
+// user_cmd 199:user:1/3:dally_r@0.0.0.0:~:maison:epitech_2011 | who rep 002 -- cmd end
+void    Protocol::handleWho(const Tokenizer& parts, NetsoulEvent& event)
+{
+  if ("rep" == parts.at(4))
+    {
+      push(NetsoulEvent::WhoEndEvent, event);
+      return;
+    }
+  if (parts.size() < 15)
+    return;
+  bool ok;
+  event.id = parts.at(4).toInt(&ok);
+  if (!ok) return;
+  event.login = field(parts, 5);
+  event.ip = field(parts, 6);
+  event.location = encodedField(parts, 12);
+  event.promo = field(parts, 13);
+  event.state = NetsoulEvent::toState(parts.at(14));
+  if (parts.size() >= 16)
+    event.comment = encodedField(parts, 15);
+  push(NetsoulEvent::WhoEvent, event);
+}
+
+// user_cmd 566:user:1/3:sundas_c@0.0.0.0:~:maison:epitech_2011 | msg test dst=dally_r
+void    Protocol::handleMsg(const Tokenizer& parts, NetsoulEvent& event)
+{
+  const Tokenizer::Field& text = parts.field(4);
+  event.message = this->_fields.encodedText(parts.data() + text.begin,
+                                            text.end - text.begin);
+  event.state = NetsoulEvent::Actif;
+  push(NetsoulEvent::MsgEvent, event);
+}
+
+// user_cmd 185:user:1/3:dally_r@0.0.0.0:~:Trolltech%20World:epitech_2011 | state lock
+void    Protocol::handleState(const Tokenizer& parts, NetsoulEvent& event)
+{
+  event.state = NetsoulEvent::toState(parts.at(4));
+  push(NetsoulEvent::StateEvent, event);
+}
+
+// Login and logout
+void    Protocol::handleLog(const Tokenizer& parts, NetsoulEvent& event)
+{
+  event.state = NetsoulEvent::toState(parts.at(3));
+  push(NetsoulEvent::StateEvent, event);
+}
+
+void    Protocol::handleTyping(const Tokenizer& parts, NetsoulEvent& event)
+{
+  event.typing = ("dotnetSoul_UserTyping" == parts.at(3));
+  push(NetsoulEvent::TypingEvent, event);
+}
+
+void    Protocol::push(const NetsoulEvent::Type type, NetsoulEvent& event)
+{
+  event.type = type;
+  this->_events->append(event);
+}
+
+void    Protocol::pushHandShaking(const int step, NetsoulEvent event)
+{
+  event.step = step;
+  push(NetsoulEvent::HandShakingEvent, event);
+}
@@ -0,0 +1,222 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <QElapsedTimer>
+#include "SessionHandoff.h"
+
+namespace
+{
+  const int MAX_PAYLOAD = 16 * 1024 * 1024;
+
+  // Room for one descriptor, aligned as CMSG_FIRSTHDR and CMSG_DATA
+  // expect
+  union ControlBuffer
+  {
+    struct cmsghdr header;
+    char           bytes[CMSG_SPACE(sizeof(int))];
+  };
+
+  // Waits for events on fd for what is left of msecs
+  bool  wait(const int fd, const short events, const QElapsedTimer& clock,
+             const int msecs)
+  {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    for (;;)
+      {
+        const int left = msecs - static_cast<int>(clock.elapsed());
+        if (left <= 0)
+          return false;
+        const int ready = ::poll(&pfd, 1, left);
+        if (ready > 0)
+          return true;
+        if (ready < 0 && EINTR != errno)
+          return false;
+      }
+  }
+
+  bool  writeAll(const int fd, const char* data, int size,
+                 const QElapsedTimer& clock, const int msecs)
+  {
+    while (size > 0)
+      {
+        const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (written > 0)
+          {
+            data += written;
+            size -= static_cast<int>(written);
+          }
+        else if (written < 0 && EINTR == errno)
+          continue;
+        else if (written < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+          {
+            if (!wait(fd, POLLOUT, clock, msecs))
+              return false;
+          }
+        else
+          return false;
+      }
+    return true;
+  }
+
+  bool  readAll(const int fd, char* data, int size,
+                const QElapsedTimer& clock, const int msecs)
+  {
+    while (size > 0)
+      {
+        const ssize_t readbytes = ::read(fd, data, size);
+        if (readbytes > 0)
+          {
+            data += readbytes;
+            size -= static_cast<int>(readbytes);
+          }
+        else if (readbytes < 0 && EINTR == errno)
+          continue;
+        else if (readbytes < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+          {
+            if (!wait(fd, POLLIN, clock, msecs))
+              return false;
+          }
+        else
+          return false;
+      }
+    return true;
+  }
+}
+
+bool    SessionHandoff::send(const int channel, const int fd,
+                             const QByteArray& payload, const int msecs)
+{
+  QElapsedTimer clock;
+  clock.start();
+  unsigned char header[4];
+  const quint32 size = static_cast<quint32>(payload.size());
+  header[0] = static_cast<unsigned char>(size >> 24);
+  header[1] = static_cast<unsigned char>(size >> 16);
+  header[2] = static_cast<unsigned char>(size >> 8);
+  header[3] = static_cast<unsigned char>(size);
+
+  struct iovec iov;
+  iov.iov_base = header;
+  iov.iov_len = sizeof(header);
+  ControlBuffer control;
+  memset(&control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.bytes;
+  msg.msg_controllen = sizeof(control.bytes);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  // The descriptor goes with the first bytes of the header
+  for (;;)
+    {
+      const ssize_t sent = ::sendmsg(channel, &msg, MSG_NOSIGNAL);
+      if (sent > 0)
+        {
+          if (!writeAll(channel, reinterpret_cast<char*>(header) + sent,
+                        static_cast<int>(sizeof(header) - sent),
+                        clock, msecs))
+            return false;
+          break;
+        }
+      if (sent < 0 && EINTR == errno)
+        continue;
+      if (sent < 0 && (EAGAIN == errno || EWOULDBLOCK == errno) &&
+          wait(channel, POLLOUT, clock, msecs))
+        continue;
+      return false;
+    }
+  return writeAll(channel, payload.constData(), payload.size(),
+                  clock, msecs);
+}
+
+bool    SessionHandoff::receive(const int channel, int& fd,
+                                QByteArray& payload, const int msecs)
+{
+  QElapsedTimer clock;
+  clock.start();
+  fd = -1;
+  unsigned char header[4];
+  struct iovec iov;
+  iov.iov_base = header;
+  iov.iov_len = sizeof(header);
+  ControlBuffer control;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.bytes;
+  msg.msg_controllen = sizeof(control.bytes);
+
+  ssize_t received;
+  for (;;)
+    {
+      received = ::recvmsg(channel, &msg, MSG_CMSG_CLOEXEC);
+      if (received > 0)
+        break;
+      if (received < 0 && EINTR == errno)
+        continue;
+      if (received < 0 && (EAGAIN == errno || EWOULDBLOCK == errno) &&
+          wait(channel, POLLIN, clock, msecs))
+        continue;
+      return false;
+    }
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+       cmsg = CMSG_NXTHDR(&msg, cmsg))
+    if (SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type)
+      memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+  if (fd < 0)
+    return false;
+
+  // The rest of the header, should the first read have been short
+  if (!readAll(channel, reinterpret_cast<char*>(header) + received,
+               static_cast<int>(sizeof(header) - received), clock, msecs))
+    {
+      ::close(fd);
+      fd = -1;
+      return false;
+    }
+  const quint32 size = (static_cast<quint32>(header[0]) << 24) |
+    (static_cast<quint32>(header[1]) << 16) |
+    (static_cast<quint32>(header[2]) << 8) | header[3];
+  if (size > static_cast<quint32>(MAX_PAYLOAD))
+    {
+      ::close(fd);
+      fd = -1;
+      return false;
+    }
+  payload.resize(static_cast<int>(size));
+  if (!readAll(channel, payload.data(), payload.size(), clock, msecs))
+    {
+      ::close(fd);
+      fd = -1;
+      return false;
+    }
+  return true;
+}
@@ -0,0 +1,194 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QThread>
+#include <QAtomicInt>
+#include "SpscQueue.hpp"
+#include "ShardedRuntime.h"
+
+namespace
+{
+  const int COLLECT_INTERVAL = 100; // milliseconds
+  const int STATS_INTERVAL = 1000;  // milliseconds
+}
+
+// One thread, one engine. Nothing here is touched by another thread
+// but the queue consumer side and the stop flag.
+class   ShardedRuntime::Shard : public QThread, public EpollEngine::Listener
+{
+ public:
+  struct Update
+  {
+    Update(void) : isStats(false) {}
+    bool               isStats;
+    NetsoulEvent       event;
+    EpollEngine::Stats stats;
+  };
+
+  Shard(void) : stopping(0) {}
+
+  void  sessionEvent(const int, const NetsoulEvent& event)
+  {
+    if (NetsoulEvent::StateEvent != event.type &&
+        NetsoulEvent::WhoEvent != event.type)
+      return;
+    Update update;
+    update.event = event;
+    this->updates.push(update);
+  }
+
+  EpollEngine        engine;
+  SpscQueue<Update>  updates;
+  QAtomicInt         stopping;
+  EpollEngine::Stats stats; // consumer side copy
+
+ protected:
+  void  run(void)
+  {
+    qint64 nextStats = this->engine.elapsed();
+    this->engine.connectAll();
+    while (!this->stopping.loadAcquire())
+      {
+        this->engine.runOnce(STATS_INTERVAL);
+        if (this->engine.elapsed() >= nextStats)
+          {
+            pushStats();
+            nextStats += STATS_INTERVAL;
+          }
+      }
+    pushStats();
+  }
+
+ private:
+  void  pushStats(void)
+  {
+    Update update;
+    update.isStats = true;
+    update.stats = this->engine.stats();
+    this->updates.push(update);
+  }
+};
+
+ShardedRuntime::ShardedRuntime(const int shards, QObject* parent)
+  : QObject(parent), _next(0), _events(0)
+{
+  for (int i = 0; i < qMax(1, shards); ++i)
+    {
+      Shard* shard = new Shard;
+      shard->engine.setListener(shard);
+      this->_shards.append(shard);
+    }
+  this->_collector.setInterval(COLLECT_INTERVAL);
+  connect(&this->_collector, SIGNAL(timeout()), SLOT(collect()));
+}
+
+ShardedRuntime::~ShardedRuntime(void)
+{
+  stop();
+  qDeleteAll(this->_shards);
+}
+
+int     ShardedRuntime::sessionCount(void) const
+{
+  int count = 0;
+  for (int i = 0; i < this->_shards.size(); ++i)
+    count += this->_shards.at(i)->engine.sessionCount();
+  return count;
+}
+
+void    ShardedRuntime::setContacts(const QStringList& logins)
+{
+  for (int i = 0; i < this->_shards.size(); ++i)
+    this->_shards.at(i)->engine.setContacts(logins);
+}
+
+// Returns the shard the session went to, -1 if its server could not
+// be resolved.
+int     ShardedRuntime::addSession(const SessionOptions& options)
+{
+  const int shard = this->_next;
+  this->_next = (this->_next + 1) % this->_shards.size();
+  if (this->_shards.at(shard)->engine.addSession(options) < 0)
+    return -1;
+  return shard;
+}
+
+bool    ShardedRuntime::start(void)
+{
+  for (int i = 0; i < this->_shards.size(); ++i)
+    if (!this->_shards.at(i)->engine.init())
+      return false;
+  for (int i = 0; i < this->_shards.size(); ++i)
+    this->_shards.at(i)->start();
+  this->_collector.start();
+  return true;
+}
+
+void    ShardedRuntime::stop(void)
+{
+  for (int i = 0; i < this->_shards.size(); ++i)
+    this->_shards.at(i)->stopping.storeRelease(1);
+  for (int i = 0; i < this->_shards.size(); ++i)
+    this->_shards.at(i)->wait();
+  this->_collector.stop();
+  collect();
+}
+
+EpollEngine::Stats      ShardedRuntime::stats(void) const
+{
+  EpollEngine::Stats total;
+  for (int i = 0; i < this->_shards.size(); ++i)
+    {
+      const EpollEngine::Stats& stats = this->_shards.at(i)->stats;
+      total.connected += stats.connected;
+      total.netsouled += stats.netsouled;
+      total.failed += stats.failed;
+      total.closed += stats.closed;
+      total.lines += stats.lines;
+      total.bytesIn += stats.bytesIn;
+      total.bytesOut += stats.bytesOut;
+    }
+  return total;
+}
+
+void    ShardedRuntime::collect(void)
+{
+  Shard::Update update;
+  for (int i = 0; i < this->_shards.size(); ++i)
+    while (this->_shards.at(i)->updates.pop(update))
+      {
+        if (update.isStats)
+          {
+            this->_shards.at(i)->stats = update.stats;
+            continue;
+          }
+        ++this->_events;
+        const NetsoulEvent& event = update.event;
+        if (NetsoulEvent::Logout == event.state)
+          {
+            if (this->_presence.remove(event.id) > 0)
+              emit presenceChanged(event);
+            continue;
+          }
+        QHash<int, NetsoulEvent::State>::iterator it =
+          this->_presence.find(event.id);
+        if (it != this->_presence.end() && it.value() == event.state)
+          continue;
+        this->_presence.insert(event.id, event.state);
+        emit presenceChanged(event);
+      }
+}
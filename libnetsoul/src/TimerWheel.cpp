@@ -0,0 +1,71 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(const int tick, const int slots)
+  : _slots(slots), _tick(tick), _current(0), _next(0)
+{
+}
+
+void    TimerWheel::start(const qint64 now)
+{
+  this->_next = now + this->_tick;
+}
+
+// Rounded up to the next tick, a timer never fires early.
+void    TimerWheel::schedule(const int owner, const int kind,
+                             const quint32 generation, const int delay)
+{
+  const int slots = this->_slots.size();
+  const int ticks = qMax(1, (delay + this->_tick - 1) / this->_tick);
+  Timer timer;
+
+  timer.owner = owner;
+  timer.kind = kind;
+  timer.generation = generation;
+  timer.rounds = (ticks - 1) / slots;
+  this->_slots[(this->_current + ticks) % slots].append(timer);
+}
+
+void    TimerWheel::advance(const qint64 now, QVector<Timer>& expired)
+{
+  while (now >= this->_next)
+    {
+      this->_current = (this->_current + 1) % this->_slots.size();
+      this->_next += this->_tick;
+
+      QVector<Timer>& slot = this->_slots[this->_current];
+      const int size = slot.size();
+      int kept = 0;
+      for (int i = 0; i < size; ++i)
+        if (0 == slot.at(i).rounds)
+          expired.append(slot.at(i));
+        else
+          {
+            slot[kept] = slot.at(i);
+            --slot[kept].rounds;
+            ++kept;
+          }
+      slot.resize(kept);
+    }
+}
+
+int     TimerWheel::msecsToNextTick(const qint64 now) const
+{
+  return static_cast<int>(qMax(qint64(0), this->_next - now));
+}
@@ -0,0 +1,66 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TokenBucket.h"
+
+TokenBucket::TokenBucket(const int rate, const int capacity)
+  : _rate(rate), _capacity(capacity), _tokens(capacity), _refilled(0)
+{
+  this->_clock.start();
+}
+
+void    TokenBucket::setRate(const int rate, const int capacity)
+{
+  refill();
+  this->_rate = qMax(1, rate);
+  this->_capacity = qMax(1, capacity);
+  if (this->_tokens > this->_capacity)
+    this->_tokens = this->_capacity;
+}
+
+int     TokenBucket::available(void)
+{
+  refill();
+  return static_cast<int>(this->_tokens);
+}
+
+void    TokenBucket::consume(const int tokens)
+{
+  refill();
+  this->_tokens -= tokens;
+}
+
+// Time left before at least one token is available.
+int     TokenBucket::msecsUntilAvailable(void)
+{
+  refill();
+  if (this->_tokens >= 1)
+    return 0;
+  return static_cast<int>((1 - this->_tokens) * 1000 / this->_rate) + 1;
+}
+
+// Credits the time elapsed since the last refill to the nanosecond,
+// so frequent calls lose nothing to rounding.
+void    TokenBucket::refill(void)
+{
+  const qint64 now = this->_clock.nsecsElapsed();
+  this->_tokens += static_cast<double>(now - this->_refilled) *
+    this->_rate / 1000000000.0;
+  this->_refilled = now;
+  if (this->_tokens > this->_capacity)
+    this->_tokens = this->_capacity;
+}
@@ -0,0 +1,186 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Tokenizer.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+# define QNS_TOKENIZER_SSE2
+# define QNS_TOKENIZER_AVX2
+# include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# define QNS_TOKENIZER_SSE2
+# include <intrin.h>
+# include <emmintrin.h>
+#endif
+
+namespace
+{
+  typedef QVarLengthArray<int, 64> Offsets;
+  // Appends the offsets of ' ', ':' and '@' found in [begin, size[
+  typedef void (*ScanFunction)(const char*, int, const int, Offsets&);
+
+  inline bool isDelimiter(const char c)
+  {
+    return (' ' == c || ':' == c || '@' == c);
+  }
+
+  void  scanScalar(const char* data, int begin, const int size,
+                    Offsets& out)
+  {
+    for (; begin < size; ++begin)
+      if (isDelimiter(data[begin]))
+        out.append(begin);
+  }
+
+#ifdef QNS_TOKENIZER_SSE2
+  inline int countTrailingZeros(unsigned int mask)
+  {
+# ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+# else
+    return __builtin_ctz(mask);
+# endif
+  }
+
+  inline void appendBits(unsigned int mask, const int base, Offsets& out)
+  {
+    while (mask)
+      {
+        out.append(base + countTrailingZeros(mask));
+        mask &= mask - 1;
+      }
+  }
+
+  void  scanSse2(const char* data, int i, const int size, Offsets& out)
+  {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i at = _mm_set1_epi8('@');
+
+    for (; i + 16 <= size; i += 16)
+      {
+        const __m128i chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i hits =
+          _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                                    _mm_cmpeq_epi8(chunk, colon)),
+                       _mm_cmpeq_epi8(chunk, at));
+        appendBits(static_cast<unsigned int>(_mm_movemask_epi8(hits)),
+                   i, out);
+      }
+    scanScalar(data, i, size, out);
+  }
+#endif
+
+#ifdef QNS_TOKENIZER_AVX2
+  __attribute__((target("avx2")))
+  void  scanAvx2(const char* data, int i, const int size, Offsets& out)
+  {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i at = _mm256_set1_epi8('@');
+
+    for (; i + 32 <= size; i += 32)
+      {
+        const __m256i chunk =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i hits =
+          _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space),
+                                          _mm256_cmpeq_epi8(chunk, colon)),
+                          _mm256_cmpeq_epi8(chunk, at));
+        appendBits(static_cast<unsigned int>(_mm256_movemask_epi8(hits)),
+                   i, out);
+      }
+    scanSse2(data, i, size, out);
+  }
+#endif
+
+  // Picked once, the first time a line is tokenized
+  ScanFunction  selectScan(const char** name)
+  {
+#ifdef QNS_TOKENIZER_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      {
+        *name = "AVX2";
+        return scanAvx2;
+      }
+#endif
+#ifdef QNS_TOKENIZER_SSE2
+    *name = "SSE2";
+    return scanSse2;
+#else
+    *name = "scalar";
+    return scanScalar;
+#endif
+  }
+
+  const char*   scanName = "scalar";
+  const ScanFunction scan = selectScan(&scanName);
+}
+
+Tokenizer::Tokenizer(void)
+{
+}
+
+// Returns the number of non empty, space separated fields.
+int     Tokenizer::tokenize(const QByteArray& line)
+{
+  this->_line = line;
+  this->_delimiters.clear();
+  this->_marks.clear();
+  this->_fields.clear();
+
+  const char* data = line.constData();
+  const int size = line.size();
+  scan(data, 0, size, this->_delimiters);
+
+  // Second pass over delimiters only, not over the bytes
+  Field current = {0, 0, 0, 0};
+  const int count = this->_delimiters.size();
+  for (int i = 0; i <= count; ++i)
+    {
+      const int offset = (i < count) ? this->_delimiters.at(i) : size;
+      if (i < count && ' ' != data[offset])
+        {
+          this->_marks.append(offset);
+          ++current.markCount;
+          continue;
+        }
+      current.end = offset;
+      if (current.end > current.begin)
+        this->_fields.append(current);
+      current.begin = offset + 1;
+      current.firstMark = this->_marks.size();
+      current.markCount = 0;
+    }
+  return this->_fields.size();
+}
+
+QByteArray Tokenizer::at(const int i) const
+{
+  const Field& f = this->_fields.at(i);
+  return QByteArray::fromRawData(this->_line.constData() + f.begin,
+                                 f.end - f.begin);
+}
+
+const char* Tokenizer::implementation(void)
+{
+  return scanName;
+}
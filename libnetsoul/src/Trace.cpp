@@ -0,0 +1,118 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Trace.h"
+
+namespace
+{
+  const char MAGIC[] = "NSTRACE1";
+  const int  MAGIC_SIZE = 8;
+
+  bool  readVarint(const QByteArray& data, int& pos, quint64& value)
+  {
+    value = 0;
+    for (int shift = 0; pos < data.size() && shift < 64; shift += 7)
+      {
+        const quint8 byte = static_cast<quint8>(data.at(pos++));
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          return true;
+      }
+    return false;
+  }
+}
+
+bool    TraceWriter::open(const QString& path)
+{
+  close();
+  this->_file.setFileName(path);
+  if (!this->_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+  this->_file.write(MAGIC, MAGIC_SIZE);
+  this->_clock.start();
+  this->_last = 0;
+  return true;
+}
+
+void    TraceWriter::write(const QByteArray& chunk)
+{
+  const qint64 now = this->_clock.nsecsElapsed() / 1000;
+  writeVarint(static_cast<quint64>(now - this->_last));
+  writeVarint(static_cast<quint64>(chunk.size()));
+  this->_file.write(chunk);
+  this->_last = now;
+}
+
+void    TraceWriter::close(void)
+{
+  if (this->_file.isOpen())
+    this->_file.close();
+}
+
+void    TraceWriter::writeVarint(quint64 value)
+{
+  char bytes[10];
+  int size = 0;
+  do
+    {
+      bytes[size] = static_cast<char>(value & 0x7f);
+      value >>= 7;
+      if (value)
+        bytes[size] |= 0x80;
+      ++size;
+    }
+  while (value);
+  this->_file.write(bytes, size);
+}
+
+bool    TraceReader::read(const QString& path, QList<Chunk>& chunks)
+{
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly))
+    {
+      this->_error = file.errorString();
+      return false;
+    }
+  const QByteArray data = file.readAll();
+  if (!data.startsWith(QByteArray(MAGIC, MAGIC_SIZE)))
+    {
+      this->_error = QObject::tr("not a NetSoul trace");
+      return false;
+    }
+
+  int pos = MAGIC_SIZE;
+  qint64 time = 0;
+  while (pos < data.size())
+    {
+      quint64 delta;
+      quint64 size;
+      if (!readVarint(data, pos, delta) || !readVarint(data, pos, size) ||
+          size > static_cast<quint64>(data.size() - pos))
+        {
+          // A capture cut short keeps its complete chunks
+          this->_error = QObject::tr("truncated trace");
+          break;
+        }
+      Chunk chunk;
+      time += static_cast<qint64>(delta);
+      chunk.time = time;
+      chunk.data = data.mid(pos, static_cast<int>(size));
+      chunks.append(chunk);
+      pos += static_cast<int>(size);
+    }
+  return true;
+}
@@ -0,0 +1,128 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Network.h"
+#include "TraceReplayer.h"
+
+TraceReplayer::TraceReplayer(Network* network, QObject* parent)
+  : QObject(parent), _network(network), _next(0), _speed(0), _wall(0),
+    _lines(0), _events(0), _bytes(0), _parse(0), _apply(0),
+    _longestApply(0), _allocations(0), _saved(0)
+{
+  this->_timer.setSingleShot(true);
+  connect(&this->_timer, SIGNAL(timeout()), SLOT(replayDue()));
+}
+
+// The trace is loaded first, disk reads stay out of the measures.
+bool    TraceReplayer::open(const QString& path)
+{
+  this->_chunks.clear();
+  return this->_reader.read(path, this->_chunks);
+}
+
+void    TraceReplayer::start(const double speed)
+{
+  this->_speed = qMax(0.0, speed);
+  this->_next = 0;
+  this->_lines = this->_events = this->_bytes = 0;
+  this->_parse = this->_apply = this->_longestApply = 0;
+  this->_protocol.reset();
+  this->_allocations = this->_protocol.fields().allocations();
+  this->_saved = this->_protocol.fields().saved();
+  this->_clock.start();
+  this->_timer.start(0);
+}
+
+// Replays every chunk whose time has come, then sleeps until the next
+// one. As fast as possible means one chunk per event loop iteration.
+void    TraceReplayer::replayDue(void)
+{
+  const qint64 origin = this->_chunks.isEmpty() ?
+    0 : this->_chunks.first().time;
+
+  while (this->_next < this->_chunks.size())
+    {
+      const TraceReader::Chunk& chunk = this->_chunks.at(this->_next);
+      if (this->_speed > 0)
+        {
+          const qint64 due =
+            static_cast<qint64>((chunk.time - origin) / this->_speed);
+          const qint64 now = this->_clock.nsecsElapsed() / 1000;
+          if (due > now)
+            {
+              this->_timer.start(static_cast<int>((due - now) / 1000));
+              return;
+            }
+        }
+      replay(chunk);
+      ++this->_next;
+      if (0 == this->_speed && this->_next < this->_chunks.size())
+        {
+          this->_timer.start(0);
+          return;
+        }
+    }
+  this->_wall = this->_clock.elapsed();
+  emit finished();
+}
+
+void    TraceReplayer::replay(const TraceReader::Chunk& chunk)
+{
+  QElapsedTimer timer;
+
+  timer.start();
+  this->_protocol.buffer().append(chunk.data.constData(), chunk.data.size());
+  this->_lines += this->_protocol.parseLines(this->_batch, this->_replies);
+  this->_parse += timer.nsecsElapsed();
+  this->_bytes += chunk.data.size();
+  this->_replies.clear();
+
+  for (int i = this->_batch.size() - 1; i >= 0; --i)
+    if (NetsoulEvent::HandShakingEvent == this->_batch.at(i).type)
+      this->_batch.removeAt(i);
+  this->_events += this->_batch.size();
+  if (this->_network && !this->_batch.isEmpty())
+    {
+      timer.restart();
+      this->_network->dispatchEvents(this->_batch);
+      const qint64 apply = timer.nsecsElapsed();
+      this->_apply += apply;
+      this->_longestApply = qMax(this->_longestApply, apply);
+    }
+  this->_batch.clear();
+}
+
+QString TraceReplayer::report(void) const
+{
+  const double seconds = qMax<qint64>(1, this->_wall) / 1000.0;
+  const double lines = qMax<quint64>(1, this->_lines);
+  const quint64 allocations =
+    this->_protocol.fields().allocations() - this->_allocations;
+  const quint64 saved = this->_protocol.fields().saved() - this->_saved;
+  return tr("%1 chunks, %2 lines, %3 events, %4 bytes in %5 ms: "
+            "%6 lines/s. Parsing %7 ms, applying %8 ms "
+            "(longest chunk %9 ms).")
+    .arg(this->_chunks.size()).arg(this->_lines).arg(this->_events)
+    .arg(this->_bytes).arg(this->_wall)
+    .arg(static_cast<qint64>(this->_lines / seconds))
+    .arg(this->_parse / 1000000.0, 0, 'f', 1)
+    .arg(this->_apply / 1000000.0, 0, 'f', 1)
+    .arg(this->_longestApply / 1000000.0, 0, 'f', 1) +
+    tr(" Fields: %1 allocations/line, %2 without the batch field table.")
+    .arg(allocations / lines, 0, 'f', 2)
+    .arg((allocations + saved) / lines, 0, 'f', 2);
+}
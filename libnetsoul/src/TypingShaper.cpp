@@ -0,0 +1,116 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TypingShaper.h"
+
+TypingShaper::TypingShaper(const int minInterval, const int idleTimeout)
+  : _minInterval(minInterval), _idleTimeout(idleTimeout),
+    _sent(0), _suppressed(0), _expired(0)
+{
+  this->_clock.start();
+}
+
+void    TypingShaper::setIntervals(const int minInterval,
+                                   const int idleTimeout)
+{
+  this->_minInterval = qMax(0, minInterval);
+  this->_idleTimeout = qMax(0, idleTimeout);
+}
+
+void    TypingShaper::insert(const QString& key, const QByteArray& destination)
+{
+  State state;
+  state.destination = destination;
+  state.sent = false;
+  state.wanted = false;
+  state.lastSent = -1;
+  state.lastActivity = this->_clock.elapsed();
+  this->_states.insert(key, state);
+}
+
+// Each call stands for one notification of the unshaped protocol.
+void    TypingShaper::update(const QString& key, const bool typing)
+{
+  QHash<QString, State>::iterator it = this->_states.find(key);
+  if (it == this->_states.end())
+    return;
+  State& state = it.value();
+  if (typing)
+    state.lastActivity = this->_clock.elapsed();
+  if (typing == state.wanted)
+    ++this->_suppressed;
+  else
+    {
+      state.wanted = typing;
+      // Back to what the peer already knows: the pending change and
+      // this one both vanish.
+      if (state.wanted == state.sent)
+        this->_suppressed += 2;
+    }
+}
+
+int     TypingShaper::poll(QList<Notification>& due)
+{
+  const qint64 now = this->_clock.elapsed();
+  qint64 next = -1;
+  QHash<QString, State>::iterator it = this->_states.begin();
+  for (; it != this->_states.end(); ++it)
+    {
+      State& state = it.value();
+      if (state.wanted && state.sent && this->_idleTimeout > 0)
+        {
+          const qint64 idle = state.lastActivity + this->_idleTimeout - now;
+          if (idle <= 0)
+            {
+              state.wanted = false;
+              ++this->_expired;
+            }
+          else if (next < 0 || idle < next)
+            next = idle;
+        }
+      if (state.wanted == state.sent)
+        continue;
+      const qint64 wait = state.lastSent < 0 ?
+        0 : state.lastSent + this->_minInterval - now;
+      if (wait > 0)
+        {
+          if (next < 0 || wait < next)
+            next = wait;
+          continue;
+        }
+      Notification notification;
+      notification.key = it.key();
+      notification.destination = state.destination;
+      notification.typing = state.wanted;
+      due.append(notification);
+      state.sent = state.wanted;
+      state.lastSent = now;
+      ++this->_sent;
+      if (state.sent && this->_idleTimeout > 0)
+        {
+          const qint64 idle = state.lastActivity + this->_idleTimeout - now;
+          if (next < 0 || idle < next)
+            next = qMax(Q_INT64_C(0), idle);
+        }
+    }
+  return static_cast<int>(next);
+}
+
+void    TypingShaper::clear(void)
+{
+  this->_states.clear();
+}
@@ -41,6 +41,13 @@ namespace
     str[cpt[1]] = 0;
     return str;
   }
+  int   hex_value(const char c)
+  {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+  }
   void    do_url_encode(std::string &out, const char *in)
   {
     char  buf[8];
@@ -71,6 +78,14 @@ QString     url_encode(const char *in)
 }
 
 QString     url_decode(const char *in)
+{
+  return url_decode(in, static_cast<int>(strlen(in)));
+}
+
+// Decode exactly size bytes, in does not need to be NUL terminated.
+// As with the NUL terminated version, a truncated escape ending the
+// input ("%4") still decodes its single digit.
+QString     url_decode(const char *in, const int size)
 {
   std::string   out;
   char  buf[8];
@@ -78,14 +93,15 @@ QString     url_decode(const char *in)
   int   i;
 
   memset(nb, 0, 5);
-  for (i = 0; in[i]; ++i)
+  out.reserve(size);
+  for (i = 0; i < size; ++i)
     {
-      if (in[i] == '%' && in[i + 1] &&
+      if (in[i] == '%' && i + 1 < size &&
           ((in[i + 1] >= '0' && in[i + 1] <= '9') ||
            (in[i + 1] >= 'A' && in[i + 1] <= 'F') ||
            (in[i + 1] >= 'a' && in[i + 1] <= 'f')))
         {
-          sprintf(nb, "0x%.2s", in + i + 1);
+          sprintf(nb, "0x%.*s", i + 2 < size ? 2 : 1, in + i + 1);
           memset(buf, 0, 8);
           buf[0] = strtol(nb, 0, 16);
           out += strip_return(buf);
@@ -98,3 +114,34 @@ QString     url_decode(const char *in)
     }
   return QString::fromStdString(out);
 }
+
+QString     url_decode(const QByteArray& in)
+{
+  return url_decode(in.constData(), in.size());
+}
+
+// Same rules as above: %XX escapes read up to two hex digits, %00 is
+// dropped.
+int         url_decode(const char *in, const int size, char *out)
+{
+  int   length = 0;
+
+  for (int i = 0; i < size; ++i)
+    {
+      const int high = (in[i] == '%' && i + 1 < size) ?
+        hex_value(in[i + 1]) : -1;
+      if (high >= 0)
+        {
+          const int low = i + 2 < size ? hex_value(in[i + 2]) : -1;
+          const char c = static_cast<char>(low < 0 ? high : high * 16 + low);
+          if (c)
+            out[length++] = c;
+          i += 2;
+        }
+      else
+        {
+          out[length++] = in[i];
+        }
+    }
+  return length;
+}
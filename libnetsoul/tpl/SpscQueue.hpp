@@ -0,0 +1,100 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SPSC_QUEUE_HPP_
+#define SPSC_QUEUE_HPP_
+
+#include <QAtomicPointer>
+
+// Unbounded single producer / single consumer queue.
+// push() must always be called from the same thread, pop() from
+// another one; neither of them takes a lock.
+// The head node is a dummy. Nodes the consumer has moved past are not
+// freed but left for the producer to reuse: they stay linked from
+// _first up to _head, so a steady flow of events allocates nothing
+// once the queue has reached its peak size.
+template <class T>
+class SpscQueue
+{
+public:
+  SpscQueue(void)
+    : _tail(new Node), _first(_tail), _headCopy(_tail), _head(_tail) {}
+  ~SpscQueue(void)
+  {
+    while (this->_first)
+      {
+        Node* next = this->_first->next.load();
+        delete this->_first;
+        this->_first = next;
+      }
+  }
+
+  // Producer side
+  void push(const T& value)
+  {
+    Node* node = allocate();
+    node->next.store(NULL);
+    node->value = value;
+    // Publish the node once its value is written.
+    this->_tail->next.storeRelease(node);
+    this->_tail = node;
+  }
+
+  // Consumer side, returns false when the queue is empty.
+  bool pop(T& value)
+  {
+    Node* head = this->_head.load();
+    Node* next = head->next.loadAcquire();
+    if (NULL == next)
+      return false;
+    value = next->value;
+    next->value = T();
+    // Hands head back to the producer.
+    this->_head.storeRelease(next);
+    return true;
+  }
+
+private:
+  struct Node
+  {
+    Node(void) : next(NULL) {}
+    QAtomicPointer<Node> next;
+    T value;
+  };
+
+  // A node the consumer is done with, a new one if there is none.
+  Node* allocate(void)
+  {
+    if (this->_first == this->_headCopy)
+      this->_headCopy = this->_head.loadAcquire();
+    if (this->_first == this->_headCopy)
+      return new Node;
+    Node* node = this->_first;
+    this->_first = node->next.load();
+    return node;
+  }
+
+  SpscQueue(const SpscQueue&); // hide copy constructor
+  SpscQueue& operator=(const SpscQueue&); // hide assign op
+
+  Node* _tail;     // producer
+  Node* _first;    // producer: oldest node, free up to _headCopy
+  Node* _headCopy; // producer: _head when last read
+  QAtomicPointer<Node> _head; // consumer, read by the producer
+};
+
+#endif // SPSC_QUEUE_HPP_
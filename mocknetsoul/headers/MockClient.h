@@ -0,0 +1,57 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOCK_CLIENT_H_
+#define MOCK_CLIENT_H_
+
+#include <QSet>
+#include <QObject>
+#include <QByteArray>
+
+class   QTcpSocket;
+class   MockServer;
+
+// One client connection of the mock server: frames lines and hands
+// them to the server, which owns the protocol logic.
+class   MockClient : public QObject
+{
+  Q_OBJECT
+
+    public:
+  MockClient(MockServer* server, QTcpSocket* socket);
+
+  void  send(const QByteArray& line);
+  void  close(void);
+  QByteArray peerAddress(void) const;
+  quint16 peerPort(void) const;
+
+  // Protocol state, only touched by MockServer
+  QByteArray     salutHash;
+  bool           authenticated; // auth_ag accepted
+  int            userId;        // once ext_user_log succeeded, else -1
+  QSet<QByteArray> watched;
+
+  private slots:
+  void  readLines(void);
+  void  disconnected(void);
+
+ private:
+  MockServer* _server;
+  QTcpSocket* _socket;
+};
+
+#endif // MOCK_CLIENT_H_
@@ -0,0 +1,128 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOCK_SERVER_H_
+#define MOCK_SERVER_H_
+
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QVector>
+#include <QByteArray>
+#include <QTcpServer>
+
+class   MockClient;
+
+// Stand-in for ns-server, enough for the client side to be measured on
+// one machine: salut, auth_ag, ext_user_log (MD5 checked against one
+// shared password), state, watch_log_user, who, msg, typing and ping.
+// Once logged in, every ping line, watch_log_user, msg and msg_user is
+// answered by "rep 002 -- cmd end", state is not answered, and who by
+// its lines then "| who rep 002 -- cmd end", whatever the client does
+// with the replies.
+// Besides the real clients it simulates a population of users whose
+// logins, logouts, state changes and messages happen at fixed rates
+// from a seeded generator, so two runs with the same options replay
+// the same traffic.
+class   MockServer : public QObject
+{
+  Q_OBJECT
+
+    public:
+  struct Options
+  {
+    Options(void)
+      : port(4242), password("password"), prefix("user_"), users(100),
+        churn(0), states(0), messages(0), ping(600), seed(1) {}
+    quint16    port;
+    QByteArray password;
+    QByteArray prefix;   // simulated logins are prefix + number
+    int        users;    // simulated population
+    double     churn;    // logins/logouts per second
+    double     states;   // state changes per second
+    double     messages; // messages per second, to real clients
+    int        ping;     // seconds between server pings, 0: never
+    uint       seed;
+  };
+
+  MockServer(const Options& options, QObject* parent = NULL);
+
+  bool  listen(void);
+  QString errorString(void) const { return this->_server.errorString(); }
+
+  // MockClient side
+  void  processLine(MockClient* client, const QByteArray& line);
+  void  removeClient(MockClient* client);
+  void  countSent(void) { ++this->_linesOut; }
+
+  private slots:
+  void  acceptClients(void);
+  void  simulate(void);
+  void  pingClients(void);
+  void  printStats(void);
+
+ private:
+  struct User
+  {
+    int         id;
+    QByteArray  login;
+    QByteArray  ip;
+    QByteArray  location; // url encoded
+    QByteArray  comment;  // url encoded
+    QByteArray  state;
+    uint        loginTime;
+    uint        stateTime;
+    MockClient* client;   // NULL for simulated users
+  };
+
+  void  extUserLog(MockClient* client, const QList<QByteArray>& parts);
+  void  userCmd(MockClient* client, const QList<QByteArray>& parts);
+  void  who(MockClient* client, const QList<QByteArray>& logins);
+  void  deliver(const User& from, const QByteArray& target,
+                const QByteArray& payload);
+  void  spawn(const int index);
+  void  login(const User& user);
+  void  logout(const int id);
+  void  setState(User& user, const QByteArray& state);
+  void  notifyWatchers(const User& user, const QByteArray& payload);
+  QByteArray info(const User& user) const;
+  QList<QByteArray> targets(const QByteArray& list) const;
+  quint32 nextRandom(void);
+
+ private:
+  Options                          _options;
+  QTcpServer                       _server;
+  QTimer                           _simulation;
+  QTimer                           _ping;
+  QTimer                           _stats;
+  int                              _nextId;
+  quint32                          _random;
+  QHash<int, User>                 _users;    // online, by id
+  QHash<QByteArray, QList<int> >   _byLogin;  // online ids per login
+  QHash<QByteArray, QList<MockClient*> > _watchers;
+  QVector<int>                     _simulated; // id or -1 if offline
+  QList<MockClient*>               _clients;  // logged in
+  double                           _churnDebt;
+  double                           _statesDebt;
+  double                           _messagesDebt;
+  int                              _seconds;
+  quint64                          _messageCount;
+  quint64                          _linesIn;
+  quint64                          _linesOut;
+};
+
+#endif // MOCK_SERVER_H_
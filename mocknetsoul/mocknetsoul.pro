@@ -0,0 +1,29 @@
+CONFIG += release console
+CONFIG -= app_bundle
+TEMPLATE = app
+# Server side stand-in, for measuring the client on one machine
+QT = core network
+
+DEPENDPATH += . \
+    headers \
+    src
+
+INCLUDEPATH += . \
+    headers
+
+# Inputs
+HEADERS += headers/MockServer.h \
+    headers/MockClient.h
+
+SOURCES += src/main.cpp \
+    src/MockServer.cpp \
+    src/MockClient.cpp
+
+# Output
+TARGET = mock-netsoul
+OBJECTS_DIR = obj
+MOC_DIR = moc
+
+unix:  DESTDIR = ../
+win32: DESTDIR = ../
+macx:  DESTDIR = .
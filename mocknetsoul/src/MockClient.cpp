@@ -0,0 +1,69 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QTcpSocket>
+#include "MockClient.h"
+#include "MockServer.h"
+
+MockClient::MockClient(MockServer* server, QTcpSocket* socket)
+  : QObject(server), authenticated(false), userId(-1),
+    _server(server), _socket(socket)
+{
+  this->_socket->setParent(this);
+  connect(this->_socket, SIGNAL(readyRead()), SLOT(readLines()));
+  connect(this->_socket, SIGNAL(disconnected()), SLOT(disconnected()));
+}
+
+void    MockClient::send(const QByteArray& line)
+{
+  this->_socket->write(line);
+  this->_server->countSent();
+}
+
+void    MockClient::close(void)
+{
+  this->_socket->disconnectFromHost();
+}
+
+QByteArray      MockClient::peerAddress(void) const
+{
+  return this->_socket->peerAddress().toString().toUtf8();
+}
+
+quint16 MockClient::peerPort(void) const
+{
+  return this->_socket->peerPort();
+}
+
+void    MockClient::readLines(void)
+{
+  while (QAbstractSocket::ConnectedState == this->_socket->state() &&
+         this->_socket->canReadLine())
+    {
+      QByteArray line = this->_socket->readLine();
+      while (line.endsWith('\n') || line.endsWith('\r'))
+        line.chop(1);
+      if (!line.isEmpty())
+        this->_server->processLine(this, line);
+    }
+}
+
+void    MockClient::disconnected(void)
+{
+  this->_server->removeClient(this);
+  deleteLater();
+}
@@ -0,0 +1,427 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <QDateTime>
+#include <QTcpSocket>
+#include <QCryptographicHash>
+#include "MockClient.h"
+#include "MockServer.h"
+
+namespace
+{
+  const int SIMULATION_TICK = 100; // milliseconds
+  const int STATS_INTERVAL = 1000; // milliseconds
+  const char* const SIMULATED_STATES[] = { "actif", "away", "idle", "lock" };
+  const QByteArray CMD_END("rep 002 -- cmd end\n");
+
+  uint  now(void)
+  {
+    return QDateTime::currentDateTime().toTime_t();
+  }
+}
+
+MockServer::MockServer(const Options& options, QObject* parent)
+  : QObject(parent), _options(options), _nextId(1),
+    _random(options.seed ? options.seed : 1),
+    _simulated(options.users, -1), _churnDebt(0), _statesDebt(0),
+    _messagesDebt(0), _seconds(0), _messageCount(0), _linesIn(0),
+    _linesOut(0)
+{
+  connect(&this->_server, SIGNAL(newConnection()), SLOT(acceptClients()));
+  connect(&this->_simulation, SIGNAL(timeout()), SLOT(simulate()));
+  connect(&this->_ping, SIGNAL(timeout()), SLOT(pingClients()));
+  connect(&this->_stats, SIGNAL(timeout()), SLOT(printStats()));
+}
+
+// The whole simulated population starts online.
+bool    MockServer::listen(void)
+{
+  // IPv4 only: a mapped IPv6 peer address would break user_cmd fields
+  if (!this->_server.listen(QHostAddress::AnyIPv4, this->_options.port))
+    return false;
+  for (int i = 0; i < this->_simulated.size(); ++i)
+    spawn(i);
+  this->_simulation.start(SIMULATION_TICK);
+  this->_stats.start(STATS_INTERVAL);
+  if (this->_options.ping > 0)
+    this->_ping.start(this->_options.ping * 1000);
+  return true;
+}
+
+// salut <socket> <hash> <client ip> <client port> <timestamp>
+void    MockServer::acceptClients(void)
+{
+  while (this->_server.hasPendingConnections())
+    {
+      QTcpSocket* socket = this->_server.nextPendingConnection();
+      MockClient* client = new MockClient(this, socket);
+      client->salutHash =
+        QCryptographicHash::hash(QByteArray::number(nextRandom()),
+                                 QCryptographicHash::Md5).toHex();
+      QByteArray salut("salut ");
+      salut.append(QByteArray::number(socket->socketDescriptor()));
+      salut.append(' ');
+      salut.append(client->salutHash);
+      salut.append(' ');
+      salut.append(client->peerAddress());
+      salut.append(' ');
+      salut.append(QByteArray::number(client->peerPort()));
+      salut.append(' ');
+      salut.append(QByteArray::number(now()));
+      salut.append('\n');
+      client->send(salut);
+    }
+}
+
+void    MockServer::processLine(MockClient* client, const QByteArray& line)
+{
+  const QList<QByteArray> parts = line.split(' ');
+  const QByteArray& command = parts.at(0);
+
+  ++this->_linesIn;
+  if ("user_cmd" == command)
+    {
+      if (client->userId >= 0 && parts.size() >= 3)
+        userCmd(client, parts);
+    }
+  else if ("state" == command)
+    {
+      if (client->userId >= 0 && parts.size() >= 2)
+        setState(this->_users[client->userId],
+                 parts.at(1).left(parts.at(1).indexOf(':')));
+    }
+  else if ("auth_ag" == command)
+    {
+      client->authenticated = true;
+      client->send(CMD_END);
+    }
+  else if ("ext_user_log" == command)
+    extUserLog(client, parts);
+  else if ("ping" == command)
+    {
+      // Like ns-server, no matter whether it answers one of ours
+      if (client->userId >= 0)
+        client->send(CMD_END);
+    }
+  else if ("exit" == command)
+    client->close();
+}
+
+// ext_user_log <login> <md5> <location> <comment>
+// md5 is the one of "hash-ip/port" followed by the password, the
+// values being those of the salut line.
+void    MockServer::extUserLog(MockClient* client,
+                               const QList<QByteArray>& parts)
+{
+  QByteArray expected(client->salutHash);
+  expected.append('-');
+  expected.append(client->peerAddress());
+  expected.append('/');
+  expected.append(QByteArray::number(client->peerPort()));
+  expected.append(this->_options.password);
+  expected = QCryptographicHash::hash(expected,
+                                      QCryptographicHash::Md5).toHex();
+
+  if (!client->authenticated || client->userId >= 0 || parts.size() < 4 ||
+      parts.at(1).isEmpty() || parts.at(2) != expected)
+    {
+      client->send("rep 033 -- ext user identification fail\n");
+      return;
+    }
+  User user;
+  user.id = this->_nextId++;
+  user.login = parts.at(1);
+  user.ip = client->peerAddress();
+  user.location = parts.at(3);
+  user.comment = parts.size() > 4 ? parts.at(4) : QByteArray();
+  user.state = "connection";
+  user.loginTime = user.stateTime = now();
+  user.client = client;
+  client->userId = user.id;
+  this->_clients.append(client);
+  login(user);
+  client->send(CMD_END);
+}
+
+// user_cmd watch_log_user {a,b}
+// user_cmd who {a,b}
+// user_cmd msg *:login@*location* msg text
+// user_cmd msg_user {a,b} msg text
+void    MockServer::userCmd(MockClient* client, const QList<QByteArray>& parts)
+{
+  const QByteArray& command = parts.at(1);
+
+  if ("watch_log_user" == command)
+    {
+      // Additive: the client sends its list in chunks
+      const QList<QByteArray> logins = targets(parts.at(2));
+      for (int i = 0; i < logins.size(); ++i)
+        if (!client->watched.contains(logins.at(i)))
+          {
+            client->watched.insert(logins.at(i));
+            this->_watchers[logins.at(i)].append(client);
+          }
+      client->send(CMD_END);
+    }
+  else if ("who" == command)
+    who(client, targets(parts.at(2)));
+  else if (("msg" == command || "msg_user" == command) && parts.size() >= 4)
+    {
+      QList<QByteArray> payload = parts.mid(3);
+      deliver(this->_users[client->userId], parts.at(2),
+              payload.join(' '));
+      client->send(CMD_END);
+    }
+}
+
+// user_cmd <requester> | who <id> <login> <ip> <login time>
+//   <state time> 3 1 ~ <location> <promo> <state>:<time> <comment>
+void    MockServer::who(MockClient* client, const QList<QByteArray>& logins)
+{
+  const QByteArray prefix =
+    "user_cmd " + info(this->_users[client->userId]) + " | who ";
+
+  for (int i = 0; i < logins.size(); ++i)
+    {
+      const QList<int> ids = this->_byLogin.value(logins.at(i));
+      for (int j = 0; j < ids.size(); ++j)
+        {
+          const User& user = this->_users[ids.at(j)];
+          QByteArray line(prefix);
+          line.append(QByteArray::number(user.id));
+          line.append(' ');
+          line.append(user.login);
+          line.append(' ');
+          line.append(user.ip);
+          line.append(' ');
+          line.append(QByteArray::number(user.loginTime));
+          line.append(' ');
+          line.append(QByteArray::number(user.stateTime));
+          line.append(" 3 1 ~ ");
+          line.append(user.location);
+          line.append(" mock ");
+          line.append(user.state);
+          line.append(':');
+          line.append(QByteArray::number(user.stateTime));
+          line.append(' ');
+          line.append(user.comment);
+          line.append('\n');
+          client->send(line);
+        }
+    }
+  client->send(prefix + "rep 002 -- cmd end\n");
+}
+
+// target is a login list, each login optionally followed by
+// @*location*; without a location every connection point gets it.
+void    MockServer::deliver(const User& from, const QByteArray& target,
+                            const QByteArray& payload)
+{
+  QByteArray list(target);
+  QByteArray location;
+  const int at = target.indexOf("@*");
+  if (at >= 0)
+    {
+      location = target.mid(at + 2);
+      while (location.endsWith('*'))
+        location.chop(1);
+      list.truncate(at);
+    }
+
+  const QByteArray prefix = "user_cmd " + info(from) + " | " + payload;
+  const QList<QByteArray> logins = targets(list);
+  for (int i = 0; i < logins.size(); ++i)
+    {
+      const QList<int> ids = this->_byLogin.value(logins.at(i));
+      for (int j = 0; j < ids.size(); ++j)
+        {
+          const User& user = this->_users[ids.at(j)];
+          if (user.client && user.id != from.id &&
+              (location.isEmpty() || location == user.location))
+            user.client->send(prefix + " dst=" + logins.at(i) + '\n');
+        }
+    }
+}
+
+void    MockServer::login(const User& user)
+{
+  this->_users.insert(user.id, user);
+  this->_byLogin[user.login].append(user.id);
+  notifyWatchers(user, "login");
+}
+
+void    MockServer::logout(const int id)
+{
+  const User user = this->_users.take(id);
+  QList<int>& ids = this->_byLogin[user.login];
+  ids.removeAll(id);
+  if (ids.isEmpty())
+    this->_byLogin.remove(user.login);
+  notifyWatchers(user, "logout");
+}
+
+void    MockServer::setState(User& user, const QByteArray& state)
+{
+  user.state = state;
+  user.stateTime = now();
+  notifyWatchers(user, "state " + state + ':' +
+                 QByteArray::number(user.stateTime));
+}
+
+void    MockServer::notifyWatchers(const User& user, const QByteArray& payload)
+{
+  const QList<MockClient*> watchers = this->_watchers.value(user.login);
+  if (watchers.isEmpty())
+    return;
+  const QByteArray line = "user_cmd " + info(user) + " | " + payload + '\n';
+  for (int i = 0; i < watchers.size(); ++i)
+    if (watchers.at(i)->userId != user.id)
+      watchers.at(i)->send(line);
+}
+
+void    MockServer::removeClient(MockClient* client)
+{
+  QSet<QByteArray>::const_iterator it = client->watched.constBegin();
+  for (; it != client->watched.constEnd(); ++it)
+    {
+      QList<MockClient*>& watchers = this->_watchers[*it];
+      watchers.removeAll(client);
+      if (watchers.isEmpty())
+        this->_watchers.remove(*it);
+    }
+  client->watched.clear();
+  if (client->userId >= 0)
+    {
+      this->_clients.removeAll(client);
+      logout(client->userId);
+      client->userId = -1;
+    }
+}
+
+// Rates are spread over ticks, the fractional part carried over.
+void    MockServer::simulate(void)
+{
+  const double seconds = SIMULATION_TICK / 1000.0;
+  const int users = this->_simulated.size();
+  if (0 == users)
+    return;
+
+  this->_churnDebt += this->_options.churn * seconds;
+  for (; this->_churnDebt >= 1; this->_churnDebt -= 1)
+    {
+      const int i = nextRandom() % users;
+      if (this->_simulated.at(i) >= 0)
+        {
+          logout(this->_simulated.at(i));
+          this->_simulated[i] = -1;
+          continue;
+        }
+      spawn(i);
+    }
+
+  this->_statesDebt += this->_options.states * seconds;
+  for (; this->_statesDebt >= 1; this->_statesDebt -= 1)
+    {
+      const int id = this->_simulated.at(nextRandom() % users);
+      if (id >= 0)
+        setState(this->_users[id], SIMULATED_STATES[nextRandom() % 4]);
+    }
+
+  this->_messagesDebt += this->_options.messages * seconds;
+  for (; this->_messagesDebt >= 1; this->_messagesDebt -= 1)
+    {
+      const int id = this->_simulated.at(nextRandom() % users);
+      if (id < 0 || this->_clients.isEmpty())
+        continue;
+      const MockClient* to =
+        this->_clients.at(nextRandom() % this->_clients.size());
+      deliver(this->_users[id], this->_users[to->userId].login,
+              "msg mock%20message%20" +
+              QByteArray::number(++this->_messageCount));
+    }
+}
+
+// Simulated user number index logs in, under a new connection id.
+void    MockServer::spawn(const int index)
+{
+  User user;
+  user.id = this->_nextId++;
+  user.login = this->_options.prefix + QByteArray::number(index);
+  user.ip = "127.0.0.1";
+  user.location = "mock";
+  user.comment = "simulated";
+  user.state = "actif";
+  user.loginTime = user.stateTime = now();
+  user.client = NULL;
+  this->_simulated[index] = user.id;
+  login(user);
+}
+
+void    MockServer::pingClients(void)
+{
+  const QByteArray ping = "ping " + QByteArray::number(this->_options.ping)
+    + '\n';
+  for (int i = 0; i < this->_clients.size(); ++i)
+    this->_clients.at(i)->send(ping);
+}
+
+// elapsed-seconds clients online lines-in lines-out messages
+void    MockServer::printStats(void)
+{
+  fprintf(stderr, "%d %d %d %llu %llu %llu\n", ++this->_seconds,
+          this->_clients.size(), this->_users.size(),
+          static_cast<unsigned long long>(this->_linesIn),
+          static_cast<unsigned long long>(this->_linesOut),
+          static_cast<unsigned long long>(this->_messageCount));
+}
+
+// id:user:1/3:login@ip:~:location:promo
+QByteArray      MockServer::info(const User& user) const
+{
+  QByteArray info(QByteArray::number(user.id));
+  info.append(":user:1/3:");
+  info.append(user.login);
+  info.append('@');
+  info.append(user.ip);
+  info.append(":~:");
+  info.append(user.location);
+  info.append(":mock");
+  return info;
+}
+
+// {a,b}, *:a or a
+QList<QByteArray>       MockServer::targets(const QByteArray& list) const
+{
+  QByteArray logins(list);
+  if (logins.startsWith('{') && logins.endsWith('}'))
+    logins = logins.mid(1, logins.size() - 2);
+  QList<QByteArray> result = logins.split(',');
+  for (int i = 0; i < result.size(); ++i)
+    if (result.at(i).startsWith("*:"))
+      result[i].remove(0, 2);
+  return result;
+}
+
+// xorshift32: deterministic for a given seed, on every platform
+quint32 MockServer::nextRandom(void)
+{
+  this->_random ^= this->_random << 13;
+  this->_random ^= this->_random >> 17;
+  this->_random ^= this->_random << 5;
+  return this->_random;
+}
@@ -0,0 +1,75 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "MockServer.h"
+
+int     main(int argc, char** argv)
+{
+  QCoreApplication      app(argc, argv);
+  QCommandLineParser    parser;
+  MockServer::Options   options;
+
+  app.setApplicationName("mock-netsoul");
+  parser.setApplicationDescription
+    ("Local NetSoul server stand-in with a simulated user population.");
+  parser.addHelpOption();
+  parser.addOptions(QList<QCommandLineOption>()
+                    << QCommandLineOption("port", "Listening port.", "port",
+                                          QString::number(options.port))
+                    << QCommandLineOption("password",
+                                          "Password of every account.",
+                                          "password", options.password)
+                    << QCommandLineOption("prefix", "Simulated logins prefix.",
+                                          "prefix", options.prefix)
+                    << QCommandLineOption("users", "Simulated users.", "n",
+                                          QString::number(options.users))
+                    << QCommandLineOption("churn",
+                                          "Logins/logouts per second.", "r",
+                                          "0")
+                    << QCommandLineOption("states",
+                                          "State changes per second.", "r",
+                                          "0")
+                    << QCommandLineOption("messages",
+                                          "Messages per second to clients.",
+                                          "r", "0")
+                    << QCommandLineOption("ping",
+                                          "Seconds between pings, 0: never.",
+                                          "s", QString::number(options.ping))
+                    << QCommandLineOption("seed", "Simulation seed.", "n",
+                                          QString::number(options.seed)));
+  parser.process(app);
+
+  options.port = parser.value("port").toUShort();
+  options.password = parser.value("password").toUtf8();
+  options.prefix = parser.value("prefix").toUtf8();
+  options.users = qMax(0, parser.value("users").toInt());
+  options.churn = parser.value("churn").toDouble();
+  options.states = parser.value("states").toDouble();
+  options.messages = parser.value("messages").toDouble();
+  options.ping = parser.value("ping").toInt();
+  options.seed = parser.value("seed").toUInt();
+
+  MockServer server(options);
+  if (!server.listen())
+    {
+      qCritical("mock-netsoul: %s", qPrintable(server.errorString()));
+      return 1;
+    }
+  return app.exec();
+}
@@ -1,2 +1,4 @@
 TEMPLATE = subdirs
-SUBDIRS = qns updater plugins
+SUBDIRS = libnetsoul qns qnsd mocknetsoul updater plugins
+qns.depends = libnetsoul
+qnsd.depends = libnetsoul
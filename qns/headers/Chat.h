@@ -18,6 +18,10 @@
 #ifndef CHAT_H
 #define CHAT_H
 
+#include <QHash>
+#include <QPair>
+#include <QDateTime>
+#include <QTextCursor>
 #include "ui_Chat.h"
 
 class   Network;
@@ -38,12 +42,18 @@ class   Chat : public QWidget, public Ui_Chat
 
   void    setAlias(const QString& alias) { this->_alias = alias; }
   void    setOptions(OptionsWidget* options) { this->_options = options; }
-  void    setNetwork(Network* network) { this->_network = network; }
+  void    setNetwork(Network* network);
 
-  QString getFormatedDateTime(void) const;
+  // when: now if invalid
+  QString getFormatedDateTime(const QDateTime& when = QDateTime()) const;
   void    insertSmileys(void);
   void    replaceUrls(QString msg);
-  void    insertMessage(const QString& a, const QString& m, const QColor&);
+  // id: of the message in the outbox, shown queued until it is sent
+  // network: whose outbox holds it, the chat's one if NULL
+  // when: time shown, now if invalid
+  void    insertMessage(const QString& a, const QString& m, const QColor&,
+                        const qint64 id = -1, Network* network = NULL,
+                        const QDateTime& when = QDateTime());
   void    notifyTypingStatus(const bool typing);
   void    setPortrait(void); // if existing
   void    autoReply(const int currentStatus);
@@ -57,6 +67,7 @@ protected:
 private slots:
   void  sendMessage(void);
   void  handleTypingSignal(void);
+  void  markSent(qint64 id);
 
 private:
   int            _id;
@@ -66,6 +77,9 @@ private:
   QRect          _geometry;
   Network*       _network;
   OptionsWidget* _options;
+  // Selects the status of each queued message, by network and id since
+  // the outbox ids of two sessions collide
+  QHash<QPair<Network*, qint64>, QTextCursor> _queued;
 };
 
 #endif // CHAT_H
@@ -18,12 +18,14 @@
 #ifndef CONTACTS_TREE_H_
 #define CONTACTS_TREE_H_
 
+#include <QSet>
 #include <QMenu>
 #include <QString>
 #include <QDropEvent>
 #include <QTreeWidget>
 #include <QContextMenuEvent>
 #include "AddContact.h"
+#include "NetsoulEvent.h"
 
 class   Network;
 class   OptionsWidget;
@@ -46,14 +48,17 @@ class   ContactsTree : public QTreeWidget
 
   void  initTree(void);
   bool  addGroup(const QString& groupName);
-  bool  updateConnectionPoint(const QStringList& properties);
+  bool  updateConnectionPoint(const NetsoulEvent& event);
   void  removeAllConnectionPoints(void);
+  void  markConnectionPointsStale(void);
   void  removeGroup(const QString& groupName);
   void  removeContact(const QString& groupName, const QString& contactName);
   void  setPortrait(const QString& login, const QString& portraitPath);
   void  saveContacts(const QString& fileName);
   bool  loadContacts(const QString& fileName);
   QStringList getLoginList(void) const;
+  // Presence shown by the tree, one who event per connection point
+  QList<NetsoulEvent> connectionPoints(void) const;
   QStringList getGroupList(void) const;
   QString getAliasByLogin(const QString& login) const;
 
@@ -69,16 +74,21 @@ public slots:
   void  sortContacts(void);
   void  togglePortrait(void);
   void  copyIp(void);
+  void  messageGroup(void);
   void  saveContacts(void);
   void  saveContactsAs(void);
   void  loadContacts(void);
   void  refreshContacts(void);
   void  monitorContacts(void);
+  void  removeStaleConnectionPoints(void);
 
 signals:
   void  downloadPortrait(const QString& login, bool fun);
-  void  openConversation(const QStringList&);
+  void  openConversation(const NetsoulEvent&);
   void  contactRemoved(const QString& login);
+  // id: see Network::transmitGroupMsg()
+  void  groupMessageSent(const QStringList& logins, const QString& message,
+                         qint64 id);
 
 protected:
   virtual void dropEvent(QDropEvent* event);
@@ -88,9 +98,12 @@ protected:
 private:
   bool  existingGroup(const QString& name) const;
   bool  existingContact(const QString& login, QTreeWidgetItem** dst) const;
+  bool  sameConnectionPoint(const QTreeWidgetItem* connectionPoint,
+                            const NetsoulEvent& event) const;
   void  openConversation(QTreeWidgetItem* connectionPoint);
   void  togglePortrait(QTreeWidgetItem* contact);
   void  createContextMenus(void);
+  QStringList selectedLogins(void) const;
 
 private:
   QMenu          _treeMenu;
@@ -102,6 +115,7 @@ private:
   AddContact     _addContactDialog;
   Network*       _network;
   OptionsWidget* _options;
+  QSet<int>      _staleIds; // kept across a reconnection, until resynced
 };
 
 #endif
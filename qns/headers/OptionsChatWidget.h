@@ -31,6 +31,8 @@ class   OptionsChatWidget : public QWidget, public AbstractOptions
 
   bool exitOnEscape(void) const { return this->_exitOnEscape; }
   bool notifyTyping(void) const { return this->_notifyTyping; }
+  int  typingInterval(void) const { return this->_typingInterval; }
+  int  typingTimeout(void) const { return this->_typingTimeout; }
   bool smileys(void) const { return this->_smileys; }
   bool notifyMsg(void) const { return this->_notifyMsg; }
   bool notifyState(void) const { return this->_notifyState; }
@@ -52,6 +54,8 @@ class   OptionsChatWidget : public QWidget, public AbstractOptions
  private:
   bool    _exitOnEscape;
   bool    _notifyTyping;
+  int     _typingInterval; // milliseconds between two notifications
+  int     _typingTimeout;  // milliseconds idle before cancelling, 0: never
   bool    _smileys;
   bool	  _notifyMsg;
   bool	  _notifyState;
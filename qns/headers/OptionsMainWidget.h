@@ -19,6 +19,7 @@
 #define OPTION_MAIN_WIDGET_H_
 
 #include <QWidget>
+#include <QStringList>
 #include "AbstractOptions.h"
 
 class	OptionsMainWidget : public QWidget, public AbstractOptions
@@ -30,6 +31,12 @@ class	OptionsMainWidget : public QWidget, public AbstractOptions
   ~OptionsMainWidget(void);
 
   bool	autoConnect(void) const { return this->_autoConnect; }
+  int	chunkBudget(void) const { return this->_chunkBudget; }
+  int	whoInFlight(void) const { return this->_whoInFlight; }
+  const QStringList&	fallbacks(void) const { return this->_fallbacks; }
+  int	pingDeadline(void) const { return this->_pingDeadline; }
+  int	floodRate(void) const { return this->_floodRate; }
+  int	floodBurst(void) const { return this->_floodBurst; }
   void	setConnectionOnOk(const bool& value) { this->_connectOnOk = value; }
 
   void	readOptions(QSettings& settings);
@@ -50,6 +57,12 @@ private:
   bool		_savePassword;
   bool		_autoConnect;
   bool		_connectOnOk;
+  int		_chunkBudget; // bytes per who/watch_log_user line
+  int		_whoInFlight; // who chunks awaiting their reply
+  QStringList	_fallbacks; // "host:port" tried after the server
+  int		_pingDeadline; // milliseconds, 0: no dead server detection
+  int		_floodRate; // bytes per second of non-critical commands
+  int		_floodBurst; // bytes
 };
 
 #endif
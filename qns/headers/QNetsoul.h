@@ -18,14 +18,17 @@
 #ifndef QNETSOUL_H_
 #define QNETSOUL_H_
 
+#include <QDateTime>
 #include <QAbstractSocket>
 #include <QSystemTrayIcon>
 #include "AddContact.h"
+#include "NetsoulEvent.h"
 #include "ui_QNetsoul.h"
 
 class   Chat;
 class   QTimer;
 class   QAction;
+class   QLocalServer;
 class   Network;
 class   Pastebin;
 class   TrayIcon;
@@ -36,6 +39,9 @@ class   OptionsWidget;
 class   ChuckNorrisFacts;
 class   PortraitResolver;
 class   PluginsManager;
+class   PresenceScheduler;
+class   TraceReplayer;
+struct  SessionOptions;
 
 class   QNetsoul : public QMainWindow, public Ui_QNetsoul
 {
@@ -48,24 +54,36 @@ class   QNetsoul : public QMainWindow, public Ui_QNetsoul
   static void openOptionsDialog(OptionsWidget* options,
                                 const int currentTab = -1,
                                 QWidget* focus = NULL);
+  // Inbound trace of the main session, see Trace.h
+  void  setCapture(const QString& path);
+  bool  replay(const QString& path, const double speed);
 
 protected:
   void  closeEvent(QCloseEvent*);
 
 private slots:
   void  connectToServer(void);
-  void  ping(void);
-  void  reconnect(void);
+  void  prepareReconnection(void);
+  void  abandonReconnection(void);
   void  disconnect(void);
   void  updateWidgets(const QAbstractSocket::SocketState&);
   void  openOptionsDialog(void);
   void  disableChats(const QString& login);
   void  saveStateBeforeQuiting(void);
+  void  quitForUpdate(void);
+  void  handOverSession(void);
   void  handleClicksOnTrayIcon(QSystemTrayIcon::ActivationReason);
-  void  changeStatus(const QStringList& properties);
-  void  updateContact(const QStringList& properties);
-  void  showConversation(const QStringList&, const QString& msg = "");
+  void  changeStatus(const NetsoulEvent& event);
+  void  updateContact(const NetsoulEvent& event);
+  void  showConversation(const NetsoulEvent&, const QString& msg = "");
+  void  recordGroupMessage(const QStringList& logins, const QString& msg,
+                           qint64 id);
   void  processHandShaking(int, QStringList);
+  void  showLoginPhase(int phase, qint64 elapsed);
+  void  showSessionMessage(const QString& message, int timeout);
+  void  showReplayReport(void);
+  void  showPingLatency(qint64 rtt);
+  void  showNetworkStatistics(void);
   void  notifyTypingStatus(const int id, const bool typing);
   void  setPortrait(const QString&);
   void  aboutQNetSoul(void);
@@ -74,29 +92,46 @@ private:
   Chat* getChat(const int id);
   void  disableChat(Chat* chat);
   void  resetAllContacts(void);
+  void  addSession(const SessionOptions& options);
+  SessionOptions mainSessionOptions(const quint16 port) const;
+  bool  resumeHandedOverSession(void);
   void  readSettings(void);
   void  writeSettings(void);
   void  setupTrayIcon(void);
   void  connectQNetsoulModules(void);
   void  connectActionsSignals(void);
   void  connectNetworkSignals(void);
-  Chat* createWindowChat(const int, const QString&, const QString&);
+  Chat* createWindowChat(const int, const QString&, const QString&,
+                         Network* session = NULL);
   void  deleteAllWindowChats(void);
 
-  Network*          _network;
+  // A group message, kept for the chats created afterwards
+  struct GroupMessage
+  {
+    QString   text;
+    qint64    id;
+    Network*  network; // whose outbox holds it
+    QDateTime sent;
+  };
+
+  Network*          _network;  // main session, the contacts tree one
+  QList<Network*>   _sessions; // additional accounts
   OptionsWidget*    _options;
   TrayIcon*         _trayIcon;
   QHash<int, Chat*> _windowsChat;
-  QString           _timeStamp;
   QPoint            _oldPos;
   PortraitResolver* _portraitResolver;
   Pastebin*         _pastebin;
   SlidingPopup*     _popup;
   VieDeMerde*       _vdm;
   ChuckNorrisFacts* _cnf;
-  QTimer*           _ping;
   InternUpdater*    _internUpdater;
   PluginsManager*   _pluginsManager;
+  PresenceScheduler* _presence;
+  QString           _capture;
+  TraceReplayer*    _replayer;
+  QLocalServer*     _handoff;  // while the new binary takes the session
+  QHash<QString, QList<GroupMessage> > _groupTranscripts; // by login
 };
 
 #endif // QNETSOUL_H_
@@ -9,6 +9,8 @@ DEPENDPATH += . \
     src \
     ui \
     ../tools \
+    ../libnetsoul/headers \
+    ../libnetsoul/tpl \
     ../plugins/pluginsmanager/ui \
     ../plugins/pluginsmanager/src \
     ../plugins/pluginsmanager/headers \
@@ -18,21 +20,20 @@ INCLUDEPATH += . \
     interfaces \
     tpl \
     ../tools \
+    ../libnetsoul/headers \
+    ../libnetsoul/tpl \
     ../plugins/pluginsmanager/headers \
 
 # Inputs
 RESOURCES += Images.qrc
 HEADERS += tpl/Singleton.hpp
 HEADERS += headers/QNetsoul.h \
-    headers/Network.h \
     headers/AddContact.h \
     headers/Chat.h \
-    headers/Url.h \
     headers/State.h \
     headers/ContactsWriter.h \
     headers/ContactsReader.h \
     headers/InputTextEdit.h \
-    headers/LocationResolver.h \
     headers/PortraitResolver.h \
     headers/Smileys.h \
     headers/VieDeMerde.h \
@@ -65,14 +66,11 @@ FORMS += ui/QNetsoul.ui \
 
 SOURCES += src/main.cpp \
     src/QNetsoul.cpp \
-    src/Network.cpp \
     src/AddContact.cpp \
     src/Chat.cpp \
-    src/Url.cpp \
     src/ContactsWriter.cpp \
     src/ContactsReader.cpp \
     src/InputTextEdit.cpp \
-    src/LocationResolver.cpp \
     src/PortraitResolver.cpp \
     src/VieDeMerde.cpp \
     src/ChuckNorrisFacts.cpp \
@@ -102,9 +100,13 @@ interfaces/iwidgetplugin.h \
 SOURCES += ../plugins/pluginsmanager/src/pluginsmanager.cpp
 HEADERS += ../plugins/pluginsmanager/headers/pluginsmanager.h
 
-# Common inputs
+# Common inputs, tools.cpp is built into libnetsoul
 HEADERS += ../tools/tools.h
-SOURCES += ../tools/tools.cpp
+
+# Headless core
+LIBS += -L../libnetsoul -lnetsoul
+unix:  PRE_TARGETDEPS += ../libnetsoul/libnetsoul.a
+win32: PRE_TARGETDEPS += ../libnetsoul/netsoul.lib
 
 # Output
 TARGET = QNetSoul
@@ -25,6 +25,16 @@
 #include "OptionsWidget.h"
 #include "PortraitResolver.h"
 
+namespace
+{
+  QTextCharFormat statusFormat(void)
+  {
+    QTextCharFormat format;
+    format.setForeground(Qt::gray);
+    return format;
+  }
+}
+
 Chat::Chat(const int id, const QString& login, const QString& loc)
   : _id(id), _alias(login), _login(login), _location(loc),
     _network(NULL), _options(NULL)
@@ -41,9 +51,20 @@ Chat::~Chat(void)
 {
 }
 
-QString Chat::getFormatedDateTime(void) const
+void    Chat::setNetwork(Network* network)
+{
+  if (this->_network)
+    QObject::disconnect(this->_network, NULL, this, NULL);
+  this->_network = network;
+  if (this->_network)
+    connect(this->_network, SIGNAL(messageSent(qint64)),
+            SLOT(markSent(qint64)));
+}
+
+QString Chat::getFormatedDateTime(const QDateTime& when) const
 {
-  return QString('('+QDateTime::currentDateTime().toString("hh:mm:ss")+')');
+  const QDateTime time = when.isValid() ? when : QDateTime::currentDateTime();
+  return QString('('+time.toString("hh:mm:ss")+')');
 }
 
 // TODO: add smileys later
@@ -107,7 +128,10 @@ void    Chat::replaceUrls(QString msg)
 
 void    Chat::insertMessage(const QString& alias,
                             const QString& msg,
-                            const QColor& color)
+                            const QColor& color,
+                            const qint64 id,
+                            Network* network,
+                            const QDateTime& when)
 {
   Q_ASSERT(this->_options);
 
@@ -117,11 +141,27 @@ void    Chat::insertMessage(const QString& alias,
   if (scrollBar && scrollBar->value() != scrollBar->maximum())
     scrollBarValue = scrollBar->value();
   QString html("<p>");
-  html += QString("<span style='color:%1;'>%2 %3</span>").arg(color.name()).arg(getFormatedDateTime()).arg(alias);
+  html += QString("<span style='color:%1;'>%2 %3</span>").arg(color.name()).arg(getFormatedDateTime(when)).arg(alias);
   html.append(": </p>");
   this->outputTextBrowser->moveCursor(QTextCursor::End);
   this->outputTextBrowser->insertHtml(html);
   replaceUrls(msg);
+  if (network == NULL)
+    network = this->_network;
+  if (id >= 0 && network && network->isPending(id))
+    {
+      QTextCursor status = this->outputTextBrowser->textCursor();
+      status.insertText(" ");
+      const int start = status.position();
+      status.insertText(tr("(queued)"), statusFormat());
+      status.setPosition(start, QTextCursor::KeepAnchor);
+      this->_queued.insert(qMakePair(network, id), status);
+      // Group messages may go out through another session than the chat's
+      if (network != this->_network)
+        connect(network, SIGNAL(messageSent(qint64)),
+                SLOT(markSent(qint64)), Qt::UniqueConnection);
+      this->outputTextBrowser->moveCursor(QTextCursor::End);
+    }
   this->outputTextBrowser->insertHtml("<br />");
   if (this->_options->chatWidget->smileys())
     insertSmileys();
@@ -166,11 +206,11 @@ void    Chat::autoReply(const int currentStatus)
   if (autoReplyMsg.isEmpty() == false)
     {
       // Fetch self login
+      const qint64 id = this->_network->transmitMsg(this->_login,
+                                                    this->_location,
+                                                    autoReplyMsg);
       insertMessage(this->_options->loginLineEdit->text(),
-                    autoReplyMsg, QColor(32, 74, 135));
-      this->_network->transmitMsg(this->_login,
-                                  this->_location,
-                                  autoReplyMsg);
+                    autoReplyMsg, QColor(32, 74, 135), id);
     }
 }
 
@@ -225,12 +265,26 @@ void    Chat::sendMessage(void)
 #endif
 
   message.replace("\n", "<br />");
+  const qint64 id =
+    this->_network->transmitMsg(this->_login, this->_location, message);
   insertMessage(this->_options->loginLineEdit->text(),
-                message, QColor(32, 74, 135));
-  this->_network->transmitMsg(this->_login, this->_location, message);
+                message, QColor(32, 74, 135), id);
   this->inputTextEdit->clear();
 }
 
+// Connected with SIGNAL(messageSent(qint64)) of the chat's network, and
+// of the ones its group messages were sent through
+void    Chat::markSent(qint64 id)
+{
+  Network* network = qobject_cast<Network*>(sender());
+  QHash<QPair<Network*, qint64>, QTextCursor>::iterator it =
+    this->_queued.find(qMakePair(network, id));
+  if (it == this->_queued.end())
+    return;
+  it.value().insertText(tr("(sent)"), statusFormat());
+  this->_queued.erase(it);
+}
+
 void    Chat::handleTypingSignal(void)
 {
   Q_ASSERT(this->_options);
@@ -112,25 +112,8 @@ bool    ContactsTree::addGroup(const QString& groupName)
   return true;
 }
 
-// properties.at(0): Login
-// properties.at(1): Id
-// properties.at(2): Ip
-// properties.at(3): Promo
-// properties.at(4): State
-// properties.at(5): Location
-// properties.at(6): Comment
-bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
-{
-  Q_ASSERT(properties.size() == 7);
-  if (properties.size() != 7)
-    {
-#ifndef QT_NO_DEBUG
-      qDebug() << "[ContactsTree::updateConnectionPoint]"
-        "Properties must contain 7 fields.";
-#endif
-      return false;
-    }
-
+bool    ContactsTree::updateConnectionPoint(const NetsoulEvent& event)
+{
   // searching contact
   QTreeWidgetItem* root = invisibleRootItem();
   const int rootChildCount = root->childCount();
@@ -139,7 +122,7 @@ bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
   QTreeWidgetItem* contact = NULL;
   for (int i = 0; i < rootChildCount; ++i)
     if (Contact == root->child(i)->data(0, Type).toInt() &&
-        properties.at(0) == root->child(i)->data(0, Login))
+        event.login == root->child(i)->data(0, Login))
       {
         // #ifndef QT_NO_DEBUG
         //         qDebug() << "[ContactsTree::updateConnectionPoint]"
@@ -153,7 +136,7 @@ bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
         group = root->child(i);
         groupChildCount = group->childCount();
         for (int j = 0; j < groupChildCount; ++j)
-          if (properties.at(0) == group->child(j)->data(0, Login))
+          if (event.login == group->child(j)->data(0, Login))
             {
               // #ifndef QT_NO_DEBUG
               //               qDebug() << "[ContactsTree::updateConnectionPoint]"
@@ -177,14 +160,14 @@ bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
   QTreeWidgetItem* connectionPoint = NULL;
   const int connectionPointsCount = contact->childCount();
   for (; cpIndex < connectionPointsCount; ++cpIndex)
-    if (properties.at(1) == contact->child(cpIndex)->data(0, Id).toString())
+    if (event.id == contact->child(cpIndex)->data(0, Id).toInt())
       {
         connectionPoint = contact->child(cpIndex);
         break;
       }
 
   // Remove it if State is offline
-  if ("logout" == properties.at(4))
+  if (NetsoulEvent::Logout == event.state)
     {
       if (connectionPoint != NULL)
         {
@@ -202,6 +185,15 @@ bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
       return false;
     }
 
+  if (connectionPoint != NULL)
+    {
+      if (this->_staleIds.remove(event.id))
+        connectionPoint->setForeground(0, QBrush());
+      // Nothing changed (resync after a reconnection), leave the UI alone
+      if (sameConnectionPoint(connectionPoint, event))
+        return true;
+    }
+
   // Create connection point if it does not exist
   if (connectionPoint == NULL)
     {
@@ -214,23 +206,21 @@ bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
 
   // Setting up the new item
   connectionPoint->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-  for (int i = 0; (states[i].state); ++i)
-    if (states[i].state == properties.at(4))
-      {
-        connectionPoint->setIcon(0, QIcon(states[i].pixmap));
-        connectionPoint->setData(0, State, states[i].displayState);
-        break;
-      }
-  connectionPoint->setText(0, properties.at(5)); // Displaying Location
+  if (NetsoulEvent::Unknown != event.state)
+    {
+      connectionPoint->setIcon(0, QIcon(states[event.state].pixmap));
+      connectionPoint->setData(0, State, states[event.state].displayState);
+    }
+  connectionPoint->setText(0, event.location); // Displaying Location
   connectionPoint->setData(0, Type, ConnectionPoint);
-  connectionPoint->setData(0, Login, properties.at(0));
-  connectionPoint->setData(0, Id, properties.at(1));
-  connectionPoint->setData(0, Ip, properties.at(2));
-  connectionPoint->setData(0, Promo, properties.at(3));
-  connectionPoint->setData(0, Location, properties.at(5));
-  if (properties.at(6) != "")
-    connectionPoint->setData(0, Comment, properties.at(6));
-  contact->setData(0, Promo, properties.at(3));
+  connectionPoint->setData(0, Login, event.login);
+  connectionPoint->setData(0, Id, event.id);
+  connectionPoint->setData(0, Ip, event.ip);
+  connectionPoint->setData(0, Promo, event.promo);
+  connectionPoint->setData(0, Location, event.location);
+  if (!event.comment.isEmpty())
+    connectionPoint->setData(0, Comment, event.comment);
+  contact->setData(0, Promo, event.promo);
   Contact::buildToolTip(contact);
   ConnectionPoint::buildToolTip(connectionPoint);
   if (contact->parent() != NULL)
@@ -240,6 +230,7 @@ bool    ContactsTree::updateConnectionPoint(const QStringList& properties)
 
 void    ContactsTree::removeAllConnectionPoints(void)
 {
+  this->_staleIds.clear();
   const QTreeWidgetItem* root = invisibleRootItem();
   const int rootChildCount = root->childCount();
   int groupChildCount;
@@ -269,6 +260,71 @@ void    ContactsTree::removeAllConnectionPoints(void)
       }
 }
 
+// Connection points survive a reconnection: they are only marked, and
+// greyed out, who replies then refresh them and the ones left are
+// removed.
+void    ContactsTree::markConnectionPointsStale(void)
+{
+  const QBrush stale = palette().brush(QPalette::Disabled, QPalette::Text);
+  QTreeWidgetItemIterator it(this);
+  for (; *it; ++it)
+    if (ConnectionPoint == (*it)->data(0, Type).toInt())
+      {
+        this->_staleIds.insert((*it)->data(0, Id).toInt());
+        (*it)->setForeground(0, stale);
+      }
+}
+
+QList<NetsoulEvent> ContactsTree::connectionPoints(void) const
+{
+  QList<NetsoulEvent> events;
+  QTreeWidgetItemIterator it(invisibleRootItem());
+  for (; *it; ++it)
+    if (ConnectionPoint == (*it)->data(0, Type).toInt())
+      {
+        const QTreeWidgetItem* item = *it;
+        NetsoulEvent event;
+        event.type = NetsoulEvent::WhoEvent;
+        event.id = item->data(0, Id).toInt();
+        event.login = item->data(0, Login).toString();
+        event.ip = item->data(0, Ip).toString();
+        event.promo = item->data(0, Promo).toString();
+        event.location = item->data(0, Location).toString();
+        event.comment = item->data(0, Comment).toString();
+        const QString state = item->data(0, State).toString();
+        for (int i = 0; states[i].state != NULL; ++i)
+          if (state == states[i].displayState)
+            event.state = static_cast<NetsoulEvent::State>(i);
+        events << event;
+      }
+  return events;
+}
+
+void    ContactsTree::removeStaleConnectionPoints(void)
+{
+  if (this->_staleIds.isEmpty())
+    return;
+#ifndef QT_NO_DEBUG
+  qDebug() << "[ContactsTree::removeStaleConnectionPoints]"
+           << this->_staleIds.size() << "connection points left";
+#endif
+  QList<QTreeWidgetItem*> stale;
+  QTreeWidgetItemIterator it(this);
+  for (; *it; ++it)
+    if (ConnectionPoint == (*it)->data(0, Type).toInt() &&
+        this->_staleIds.contains((*it)->data(0, Id).toInt()))
+      stale << *it;
+  this->_staleIds.clear();
+  for (int i = 0; i < stale.size(); ++i)
+    {
+      QTreeWidgetItem* contact = stale.at(i)->parent();
+      delete contact->takeChild(contact->indexOfChild(stale.at(i)));
+      Contact::buildToolTip(contact);
+      if (contact->parent() != NULL)
+        Group::buildToolTip(contact->parent());
+    }
+}
+
 void    ContactsTree::removeGroup(const QString& groupName)
 {
   QTreeWidgetItem* root = invisibleRootItem();
@@ -615,6 +671,25 @@ void    ContactsTree::copyIp(void)
     clipboard->setText(ip);
 }
 
+// Slot used by group, contact and connection point contextMenu
+void    ContactsTree::messageGroup(void)
+{
+  Q_ASSERT(this->_network);
+
+  const QStringList logins = selectedLogins();
+  if (logins.isEmpty()) return;
+  bool ok = false;
+  QString message =
+    QInputDialog::getMultiLineText(this, "QNetSoul " + tr("Message group"),
+                                   tr("Message to %1:")
+                                   .arg(logins.join(", ")),
+                                   QString(), &ok);
+  if (!ok || message.isEmpty()) return;
+  message.replace("\n", "<br />");
+  const qint64 id = this->_network->transmitGroupMsg(logins, message);
+  emit groupMessageSent(logins, message, id);
+}
+
 void    ContactsTree::saveContacts(void)
 {
   Q_ASSERT(this->_options);
@@ -818,6 +893,18 @@ bool    ContactsTree::existingGroup(const QString& name) const
   return false;
 }
 
+bool    ContactsTree::sameConnectionPoint(const QTreeWidgetItem* cp,
+                                          const NetsoulEvent& event) const
+{
+  return ((NetsoulEvent::Unknown == event.state ||
+           states[event.state].displayState == cp->data(0, State).toString())
+          && event.location == cp->data(0, Location).toString()
+          && event.ip == cp->data(0, Ip).toString()
+          && event.promo == cp->data(0, Promo).toString()
+          && (event.comment.isEmpty() ||
+              event.comment == cp->data(0, Comment).toString()));
+}
+
 bool    ContactsTree::existingContact(const QString& login,
                                       QTreeWidgetItem** dst) const
 {
@@ -847,28 +934,21 @@ bool    ContactsTree::existingContact(const QString& login,
   return false;
 }
 
-// properties.at(0): Login
-// properties.at(1): Id
-// properties.at(2): Ip
-// properties.at(3): Promo
-// properties.at(4): State
-// properties.at(5): Location
-// properties.at(6): Comment
+// State is not kept by items, only its display string
 void    ContactsTree::openConversation(QTreeWidgetItem* connectionPoint)
 {
 #ifndef QT_NO_DEBUG
   if (connectionPoint->data(0, Type).toInt() != ConnectionPoint)
     qFatal("[ContactsTree::openConversation] Logic failure");
 #endif
-  QStringList properties;
-  properties << connectionPoint->data(0, Login).toString()
-             << connectionPoint->data(0, Id).toString()
-             << connectionPoint->data(0, Ip).toString()
-             << connectionPoint->data(0, Promo).toString()
-             << connectionPoint->data(0, State).toString()
-             << connectionPoint->data(0, Location).toString()
-             << connectionPoint->data(0, Comment).toString();
-  emit openConversation(properties);
+  NetsoulEvent event;
+  event.login = connectionPoint->data(0, Login).toString();
+  event.id = connectionPoint->data(0, Id).toInt();
+  event.ip = connectionPoint->data(0, Ip).toString();
+  event.promo = connectionPoint->data(0, Promo).toString();
+  event.location = connectionPoint->data(0, Location).toString();
+  event.comment = connectionPoint->data(0, Comment).toString();
+  emit openConversation(event);
 }
 
 void    ContactsTree::togglePortrait(QTreeWidgetItem* contact)
@@ -923,4 +1003,41 @@ void    ContactsTree::createContextMenus(void)
 
   // connection point menu
   this->_connectionPointMenu.addAction(tr("&Copy ip"), this, SLOT(copyIp()));
+
+  // group, contact and connection point menus
+  this->_groupMenu.addSeparator();
+  this->_groupMenu
+    .addAction(tr("&Message group..."), this, SLOT(messageGroup()));
+  this->_contactMenu.addSeparator();
+  this->_contactMenu
+    .addAction(tr("&Message selection..."), this, SLOT(messageGroup()));
+  this->_connectionPointMenu.addSeparator();
+  this->_connectionPointMenu
+    .addAction(tr("&Message selection..."), this, SLOT(messageGroup()));
+}
+
+// Logins of the selected groups, contacts and connection points, or
+// of the current item when it is not part of the selection
+QStringList     ContactsTree::selectedLogins(void) const
+{
+  QList<QTreeWidgetItem*> items = selectedItems();
+  QTreeWidgetItem* current = currentItem();
+  if (current && !items.contains(current))
+    items = QList<QTreeWidgetItem*>() << current;
+
+  QStringList logins;
+  for (int i = 0; i < items.size(); ++i)
+    {
+      const QTreeWidgetItem* item = items.at(i);
+      if (Group == item->data(0, Type).toInt())
+        {
+          for (int j = 0; j < item->childCount(); ++j)
+            logins << item->child(j)->data(0, Login).toString();
+        }
+      else
+        logins << item->data(0, Login).toString();
+    }
+  logins.removeDuplicates();
+  logins.removeAll(QString());
+  return logins;
 }
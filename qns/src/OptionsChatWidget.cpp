@@ -20,7 +20,8 @@
 
 OptionsChatWidget::OptionsChatWidget(QWidget* parent)
   : QWidget(parent), _exitOnEscape(false),
-    _notifyTyping(false), _smileys(false),
+    _notifyTyping(false), _typingInterval(1000), _typingTimeout(5000),
+    _smileys(false),
     _notifyMsg(false), _notifyState(false),
     _oldComboBoxValue(-42), _replyComboBoxValue(0)
 {
@@ -42,6 +43,8 @@ void    OptionsChatWidget::readOptions(QSettings& settings)
   settings.beginGroup("ChatOptions");
   this->_exitOnEscape = settings.value("exitonescape", false).toBool();
   this->_notifyTyping = settings.value("notifytyping", false).toBool();
+  this->_typingInterval = settings.value("typinginterval", 1000).toInt();
+  this->_typingTimeout = settings.value("typingtimeout", 5000).toInt();
   this->_smileys = settings.value("smileys", false).toBool();
   this->_notifyMsg = settings.value("notifymsg", false).toBool();
   this->_notifyState = settings.value("notifystate", false).toBool();
@@ -58,6 +61,8 @@ void    OptionsChatWidget::writeOptions(QSettings& settings)
   settings.beginGroup("ChatOptions");
   settings.setValue("exitonescape", this->_exitOnEscape);
   settings.setValue("notifytyping", this->_notifyTyping);
+  settings.setValue("typinginterval", this->_typingInterval);
+  settings.setValue("typingtimeout", this->_typingTimeout);
   settings.setValue("smileys", this->_smileys);
   settings.setValue("notifymsg", this->_notifyMsg);
   settings.setValue("notifystate", this->_notifyState);
@@ -23,7 +23,9 @@
 
 OptionsMainWidget::OptionsMainWidget(QWidget* parent)
   : QWidget(parent), _savePassword(false),
-    _autoConnect(false), _connectOnOk(false)
+    _autoConnect(false), _connectOnOk(false),
+    _chunkBudget(1024), _whoInFlight(4), _pingDeadline(30000),
+    _floodRate(1024), _floodBurst(4096)
 {
 }
 
@@ -42,6 +44,12 @@ void	OptionsMainWidget::readOptions(QSettings& settings)
   this->_password = settings.value("password").toString();
   this->_savePassword = settings.value("savepassword", false).toBool();
   this->_autoConnect = settings.value("autoconnect", false).toBool();
+  this->_chunkBudget = settings.value("chunkbudget", 1024).toInt();
+  this->_whoInFlight = settings.value("whoinflight", 4).toInt();
+  this->_fallbacks = settings.value("fallbackservers").toStringList();
+  this->_pingDeadline = settings.value("pingdeadline", 30000).toInt();
+  this->_floodRate = settings.value("floodrate", 1024).toInt();
+  this->_floodBurst = settings.value("floodburst", 4096).toInt();
   settings.endGroup();
 
   this->_password = Tools::unencrypt(this->_password);
@@ -60,6 +68,12 @@ void	OptionsMainWidget::writeOptions(QSettings& settings)
     settings.remove("password");
   settings.setValue("savepassword", this->_savePassword);
   settings.setValue("autoconnect", this->_autoConnect);
+  settings.setValue("chunkbudget", this->_chunkBudget);
+  settings.setValue("whoinflight", this->_whoInFlight);
+  settings.setValue("fallbackservers", this->_fallbacks);
+  settings.setValue("pingdeadline", this->_pingDeadline);
+  settings.setValue("floodrate", this->_floodRate);
+  settings.setValue("floodburst", this->_floodBurst);
   settings.endGroup();
 }
 
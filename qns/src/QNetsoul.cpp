@@ -15,9 +15,16 @@
   along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QDir>
 #include <QTimer>
 #include <QDateTime>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QPushButton>
+#include <QDataStream>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
 #include <QCryptographicHash>
 
 #include "Url.h"
@@ -32,22 +39,43 @@
 #include "OptionsWidget.h"
 #include "ChuckNorrisFacts.h"
 #include "PortraitResolver.h"
+#include "PresenceScheduler.h"
+#include "TraceReplayer.h"
+#include "SessionOptions.h"
 #include "Credentials.h"
 #include "Singleton.hpp"
 #include "tools.h"
 #include "pluginsmanager.h"
+#ifdef Q_OS_LINUX
+# include <unistd.h>
+# include "SessionHandoff.h"
+#endif
 
 // Imported from tools.cpp
 extern const State states[];
 
+namespace
+{
+  // A self-update restart hands the main session over on it, see
+  // quitForUpdate()
+  const QString HandoffServerName = "QNetSoul-handoff";
+  const quint32 HandoffVersion = 1;
+  const int HandoffTimeout = 5000;
+  // How long the old process waits for the new one
+  const int HandoffWait = 60000;
+  // Group messages kept per login for chats not open yet
+  const int GroupTranscriptSize = 50;
+}
+
 QNetsoul::QNetsoul(void)
   : _network(new Network(this)), _options(new OptionsWidget(this)),
     _trayIcon(NULL), _portraitResolver(new PortraitResolver),
     _pastebin(new Pastebin), _popup(new SlidingPopup(300, 200)),
     _vdm(new VieDeMerde(this->_popup)),
-    _cnf(new ChuckNorrisFacts(this->_popup)), _ping(new QTimer(this)),
+    _cnf(new ChuckNorrisFacts(this->_popup)),
     _internUpdater(new InternUpdater(this)),
-    _pluginsManager(new PluginsManager)
+    _pluginsManager(new PluginsManager), _presence(NULL), _replayer(NULL),
+    _handoff(NULL)
 {
   setupUi(this);
   setupTrayIcon();
@@ -63,9 +91,10 @@ QNetsoul::QNetsoul(void)
   readSettings();
   this->tree->setOptions(this->_options);
   this->tree->setNetwork(this->_network);
-  this->_network->setOptions(this->_options);
+  this->_presence = new PresenceScheduler(this->_network);
   this->tree->initTree();
-  if (this->_options->mainWidget->autoConnect())
+  if (!resumeHandedOverSession() &&
+      this->_options->mainWidget->autoConnect())
     connectToServer();
   this->_portraitResolver->addRequest(this->tree->getLoginList());
   const QString startWith = this->_options->funWidget->getStartingModule();
@@ -150,8 +179,10 @@ void    QNetsoul::connectToServer(void)
           quint16 port = this->_options->portLineEdit->text().toUShort(&ok);
           if (ok)
             {
-              this->_network->connect(this->_options->serverLineEdit->text(),
-                                      port);
+              this->_network->setSessionOptions(mainSessionOptions(port));
+              this->_network->connect();
+              for (int i = 0; i < this->_sessions.size(); ++i)
+                this->_sessions.at(i)->connect();
               return;
             }
           else
@@ -177,31 +208,52 @@ void    QNetsoul::connectToServer(void)
     }
 }
 
-void    QNetsoul::ping(void)
+SessionOptions  QNetsoul::mainSessionOptions(const quint16 port) const
 {
-  Q_ASSERT(this->_network);
-#ifndef QT_NO_DEBUG
-  qDebug() << "[QNetsoul::ping] Pingin'...";
-#endif
-  this->_network->sendMessage("ping\n");
-  this->tree->refreshContacts();
+  SessionOptions options;
+  options.server = this->_options->serverLineEdit->text();
+  options.port = port;
+  options.login = this->_options->loginLineEdit->text();
+  options.password = this->_options->passwordLineEdit->text();
+  options.location = this->_options->locationLineEdit->text();
+  options.comment = this->_options->commentLineEdit->text();
+  options.chunkBudget = this->_options->mainWidget->chunkBudget();
+  options.whoInFlight = this->_options->mainWidget->whoInFlight();
+  options.fallbacks = this->_options->mainWidget->fallbacks();
+  options.pingDeadline = this->_options->mainWidget->pingDeadline();
+  options.floodRate = this->_options->mainWidget->floodRate();
+  options.floodBurst = this->_options->mainWidget->floodBurst();
+  options.typingInterval = this->_options->chatWidget->typingInterval();
+  options.typingTimeout = this->_options->chatWidget->typingTimeout();
+  options.capture = this->_capture;
+  options.outbox = QDir::toNativeSeparators(QDir::currentPath() +
+                                            "/outbox.journal");
+  return options;
 }
 
-void    QNetsoul::reconnect(void)
+// The main session reconnects by itself: keep the tree as it is, the
+// who sweep that follows the handshake only updates what changed and
+// drops what is left.
+void    QNetsoul::prepareReconnection(void)
 {
-#ifndef QT_NO_DEBUG
-  qDebug() << "[QNetsoul::reconnect] Reconnecting...";
-#endif
-  this->statusbar->showMessage(tr("Reconnecting..."));
-  disconnect();
-  connectToServer();
+  this->_presence->stop();
+  this->tree->markConnectionPointsStale();
+}
+
+// Nothing will refresh what the tree shows any more.
+void    QNetsoul::abandonReconnection(void)
+{
+  this->_presence->stop();
+  resetAllContacts();
 }
 
 void    QNetsoul::disconnect(void)
 {
-  this->_ping->stop();
+  this->_presence->stop();
   resetAllContacts();
   this->_network->disconnect();
+  for (int i = 0; i < this->_sessions.size(); ++i)
+    this->_sessions.at(i)->disconnect();
 }
 
 void    QNetsoul::updateWidgets(const QAbstractSocket::SocketState& state)
@@ -259,6 +311,103 @@ void    QNetsoul::saveStateBeforeQuiting(void)
   qApp->quit();
 }
 
+// Connected with SIGNAL(quitApplication()) of InternUpdater only: the
+// Updater is about to start the new binary, which takes the main
+// session over instead of logging in again. Wait for it, out of sight.
+// Quitting by hand still ends the session.
+void    QNetsoul::quitForUpdate(void)
+{
+#ifdef Q_OS_LINUX
+  if (QAbstractSocket::ConnectedState == this->_network->state() &&
+      NULL == this->_handoff)
+    {
+      this->tree->saveContacts();
+      writeSettings();
+      this->_handoff = new QLocalServer(this);
+      QLocalServer::removeServer(HandoffServerName);
+      if (this->_handoff->listen(HandoffServerName))
+        {
+          connect(this->_handoff, SIGNAL(newConnection()),
+                  SLOT(handOverSession()));
+          QTimer::singleShot(HandoffWait, qApp, SLOT(quit()));
+          hide();
+          if (this->_trayIcon)
+            this->_trayIcon->hide();
+          return;
+        }
+    }
+#endif
+  saveStateBeforeQuiting();
+}
+
+// Old process side: the descriptor of the main session, what its
+// Network needs to go on and the presence shown by the tree.
+void    QNetsoul::handOverSession(void)
+{
+#ifdef Q_OS_LINUX
+  QLocalSocket* peer = this->_handoff->nextPendingConnection();
+  QByteArray session;
+  const int fd = this->_network->detach(session);
+  if (fd >= 0)
+    {
+      QByteArray payload;
+      QDataStream out(&payload, QIODevice::WriteOnly);
+      out << HandoffVersion << session << this->tree->connectionPoints();
+      const bool sent =
+        SessionHandoff::send(static_cast<int>(peer->socketDescriptor()), fd,
+                             payload, HandoffTimeout);
+      ::close(fd);
+#ifndef QT_NO_DEBUG
+      qDebug() << "[QNetsoul::handOverSession]"
+               << (sent ? "Session handed over." : "Handoff failed.");
+#else
+      Q_UNUSED(sent);
+#endif
+    }
+  peer->close();
+#endif
+  qApp->quit();
+}
+
+// New process side, started by the Updater: false unless an old
+// process handed its session over.
+bool    QNetsoul::resumeHandedOverSession(void)
+{
+#ifdef Q_OS_LINUX
+  QLocalSocket peer;
+  peer.connectToServer(HandoffServerName);
+  if (!peer.waitForConnected(HandoffTimeout))
+    return false;
+  int fd = -1;
+  QByteArray payload;
+  if (!SessionHandoff::receive(static_cast<int>(peer.socketDescriptor()),
+                               fd, payload, HandoffTimeout))
+    return false;
+  QDataStream in(payload);
+  quint32 version = 0;
+  QByteArray session;
+  QList<NetsoulEvent> snapshot;
+  in >> version >> session >> snapshot;
+  this->_network->setSessionOptions
+    (mainSessionOptions(this->_options->portLineEdit->text().toUShort()));
+  if (HandoffVersion != version || !this->_network->resume(fd, session))
+    {
+      ::close(fd);
+      return false;
+    }
+  for (int i = 0; i < snapshot.size(); ++i)
+    updateContact(snapshot.at(i));
+  // watch_log_user stays registered on the server side
+  this->_presence->setContacts(this->tree->getLoginList());
+  this->_presence->resume(snapshot);
+  for (int i = 0; i < this->_sessions.size(); ++i)
+    this->_sessions.at(i)->connect();
+  return true;
+#else
+  return false;
+#endif
+}
+
 void    QNetsoul::handleClicksOnTrayIcon
 (QSystemTrayIcon::ActivationReason reason)
 {
@@ -276,103 +425,64 @@ void    QNetsoul::handleClicksOnTrayIcon
     }
 }
 
-// Connected with SIGNAL(state(const QStringList&))
-// properties.at(0): Login
-// properties.at(1): Id
-// properties.at(2): Ip
-// properties.at(3): Promo
-// properties.at(4): State
-// properties.at(5): Location
-// properties.at(6): Comment
-void    QNetsoul::changeStatus(const QStringList& properties)
-{
-  bool ok;
-  Chat* chat = NULL;
-  int id = properties.at(1).toInt(&ok);
-  if (ok)
-    chat = getChat(id);
-  else
-    qFatal("[QNetSoul::changeStatus] "
-           "properties.at(1) must be a number. "
-           "current value == %s",
-           properties.at(1).toStdString().c_str());
-
+// Connected with SIGNAL(state(const NetsoulEvent&))
+void    QNetsoul::changeStatus(const NetsoulEvent& event)
+{
+  Chat* chat = getChat(event.id);
   if (chat == NULL)
-    chat = createWindowChat(id, properties.at(0), properties.at(5));
-
-  for (int i = 0; (states[i].state); ++i)
-    if (properties.at(4) == states[i].state)
-      {
-        chat->statusLabel->setPixmap(QPixmap(states[i].pixmap));
-        if ("login" == properties.at(4))
-          // get comment field
-          this->_network->refreshContact(properties.at(0));
-        else if ("logout" == properties.at(4))
-          {
-            disableChat(chat);
-          }
-        if (this->_trayIcon && this->_options->chatWidget->notifyState())
-          this->_trayIcon->showMessage
-            (this->tree->getAliasByLogin(properties.at(0)),
-             tr("is now ") + states[i].displayState);
-        break;
-      }
-  this->tree->updateConnectionPoint(properties);
-}
-
-// Connected with SIGNAL(who(const QStringList&))
-// properties.at(0): Login
-// properties.at(1): Id
-// properties.at(2): Ip
-// properties.at(3): Promo
-// properties.at(4): State
-// properties.at(5): Location
-// properties.at(6): Comment
-void    QNetsoul::updateContact(const QStringList& properties)
-{
-  bool ok;
-  Chat* chat = NULL;
-  int id = properties.at(1).toInt(&ok);
-  if (ok)
-    chat = getChat(id);
-  else
-    qFatal("[QNetSoul::updateContact]"
-           "properties.at(1) a.k.a id must be a number."
-           "current value == %s",
-           properties.at(1).toStdString().c_str());
+    chat = createWindowChat(event.id, event.login, event.location);
 
+  if (NetsoulEvent::Unknown != event.state)
+    {
+      const State& state = states[event.state];
+      chat->statusLabel->setPixmap(QPixmap(state.pixmap));
+      if (NetsoulEvent::Connection == event.state)
+        // get comment field
+        this->_network->refreshContact(event.login);
+      else if (NetsoulEvent::Logout == event.state)
+        disableChat(chat);
+      if (this->_trayIcon && this->_options->chatWidget->notifyState())
+        this->_trayIcon->showMessage
+          (this->tree->getAliasByLogin(event.login),
+           tr("is now ") + state.displayState);
+    }
+  this->tree->updateConnectionPoint(event);
+}
+
+// Connected with SIGNAL(who(const NetsoulEvent&))
+void    QNetsoul::updateContact(const NetsoulEvent& event)
+{
+  Chat* chat = getChat(event.id);
   if (chat == NULL)
-    chat = createWindowChat(id, properties.at(0), properties.at(5));
-
-  for (int i = 0; (states[i].state); ++i)
-    if (properties.at(4) == states[i].state)
-      chat->statusLabel->setPixmap(QPixmap(states[i].pixmap));
-  this->tree->updateConnectionPoint(properties);
-}
-
-// properties.at(0): Login
-// properties.at(1): Id
-// properties.at(2): Ip
-// properties.at(3): Promo
-// properties.at(4): State
-// properties.at(5): Location
-// properties.at(6): Comment
-void    QNetsoul::showConversation(const QStringList& properties,
+    chat = createWindowChat(event.id, event.login, event.location);
+
+  if (NetsoulEvent::Unknown != event.state)
+    chat->statusLabel->setPixmap(QPixmap(states[event.state].pixmap));
+  this->tree->updateConnectionPoint(event);
+}
+
+void    QNetsoul::showConversation(const NetsoulEvent& event,
                                    const QString& message)
 {
-  bool ok;
-  const int id = properties.at(1).toInt(&ok);
-  if (ok == false)
-    qFatal("[QNetsoul::showConversation] Invalid id (%d)", id);
-
-  Chat* window = getChat(id);
+  Chat* window = getChat(event.id);
   const bool userEvent = message.isEmpty();
 
+  if (!userEvent && this->_options->blockedWidget->isBlocked(event.login))
+    {
+#ifndef QT_NO_DEBUG
+      qDebug() << "[QNetsoul::showConversation]"
+               << "Message blocked from"
+               << event.login << ":" << message;
+#endif
+      return;
+    }
   if (NULL == window)
     {
       // DEBUG focus
       //qDebug() << "CASE 1";
-      window = createWindowChat(id, properties.at(0), properties.at(5));
+      // Answer through the session the message came from
+      window = createWindowChat(event.id, event.login, event.location,
+                                qobject_cast<Network*>(sender()));
       window->show();
     }
   if (false == window->isVisible())
@@ -406,89 +516,145 @@ void    QNetsoul::showConversation(const QStringList& properties,
     {
       if (window)
         {
-          window->insertMessage(properties.at(0), message, QColor(204, 0, 0));
+          window->insertMessage(event.login, message, QColor(204, 0, 0));
           window->autoReply(statusComboBox->currentIndex());
           QApplication::alert(window);
         }
       if (this->_trayIcon && this->_options->chatWidget->notifyMsg())
-        this->_trayIcon->showMessage(properties.at(0), tr(" is talking to you."));
+        this->_trayIcon->showMessage(event.login, tr(" is talking to you."));
     }
 }
 
-void    QNetsoul::processHandShaking(int step, QStringList args)
+// Login itself is done by Network, only the tree is fed from here.
+void    QNetsoul::processHandShaking(int step, QStringList)
 {
-  static QByteArray sum;
-
 #ifndef QT_NO_DEBUG
   //qDebug() << "[QNetsoul::processHandShaking] Step:" << step;
 #endif
 
   switch (step)
     {
-    case 0:
-      {
-        const QString password(this->_options->passwordLineEdit->text());
-        if (!password.isEmpty() && args.size() > 3)
-          {
-            sum.clear();
-            this->_timeStamp = args.at(5);
-            sum.append(QString("%1-%2/%3%4")
-                       .arg(args.at(2)).arg(args.at(3))
-                       .arg(args.at(4)).arg(password));
-            sum = QCryptographicHash::hash(sum, QCryptographicHash::Md5);
-            this->_network->sendMessage("auth_ag ext_user none none\n");
-          }
-        break;
-      }
-    case 1:
-      {
-        QByteArray message;
-        const QString hex = sum.toHex();
-        QString location(this->_options->locationLineEdit->text());
-        QString comment(this->_options->commentLineEdit->text());
-
-        if (location.isEmpty() || location.contains("%L"))
-          this->_network->resolveLocation(location);
-        if (comment.isEmpty())
-          comment = Tools::defaultComment();
-        message.append("ext_user_log ");
-        message.append(this->_options->loginLineEdit->text() + ' ');
-        message.append(hex);
-        message.append(' ');
-        message.append(url_encode(location.toStdString().c_str()));
-        //message.append(QUrl::toPercentEncoding(location.toLatin1()));
-        message.append(' ');
-        message.append(url_encode(comment.toStdString().c_str()));
-        //message.append(QUrl::toPercentEncoding(comment.toLatin1()));
-        message.append('\n');
-        this->_network->sendMessage(message);
-        break;
-      }
     case 2:
-      {
-        QByteArray state;
-        QDateTime  dt = QDateTime::currentDateTime();
-
-        state.append("state actif:");
-        state.append(QString::number(static_cast<uint>(dt.toTime_t())));
-        state.append("\n");
-        this->_network->sendMessage(state);
-        this->tree->monitorContacts();
-        this->tree->refreshContacts();
-        this->_ping->start(10000); // every 10 seconds, ping the server
-        this->statusbar->showMessage(tr("You are now NetSouled."), 2000);
-        break;
-      }
+      // Queued in the same tick as state, they leave in a single write.
+      this->tree->monitorContacts();
+      this->_presence->setContacts(this->tree->getLoginList());
+      this->_presence->start(); // full who sweep, then on demand
+      // No sweep to finish: nothing can confirm the stale points
+      if (this->tree->getLoginList().isEmpty())
+        this->tree->removeStaleConnectionPoints();
+      break;
     case -1:
-      {
-        disconnect();
-        this->statusbar->showMessage(tr("Authentification failed."));
-        break;
-      }
+      this->_presence->stop();
+      resetAllContacts();
+      break;
     default:;
     }
 }
 
+void    QNetsoul::showLoginPhase(int phase, qint64 elapsed)
+{
+  if (Network::FirstWho != phase)
+    return;
+  this->statusbar->showMessage
+    (tr("NetSouled in %1 ms (connect %2 ms, salut %3 ms, auth %4 ms)")
+     .arg(elapsed)
+     .arg(this->_network->loginPhase(Network::TcpConnect))
+     .arg(this->_network->loginPhase(Network::SalutReceived))
+     .arg(this->_network->loginPhase(Network::Authenticated)), 5000);
+}
+
+void    QNetsoul::setCapture(const QString& path)
+{
+  SessionOptions options = this->_network->sessionOptions();
+
+  this->_capture = path;
+  options.capture = path;
+  this->_network->setSessionOptions(options);
+}
+
+// Plays a capture into the main session: the contacts tree and the
+// chats apply it as if it came from the server.
+bool    QNetsoul::replay(const QString& path, const double speed)
+{
+  if (NULL == this->_replayer)
+    {
+      this->_replayer = new TraceReplayer(this->_network, this);
+      connect(this->_replayer, SIGNAL(finished()), SLOT(showReplayReport()));
+    }
+  if (!this->_replayer->open(path))
+    {
+      QMessageBox::warning(this, "QNetSoul",
+                           tr("Cannot replay %1: %2.")
+                           .arg(path, this->_replayer->errorString()));
+      return false;
+    }
+  this->_replayer->start(speed);
+  return true;
+}
+
+void    QNetsoul::showReplayReport(void)
+{
+  this->statusbar->showMessage(this->_replayer->report());
+#ifndef QT_NO_DEBUG
+  qDebug() << "[QNetsoul::showReplayReport]" << this->_replayer->report();
+#endif
+}
+
+// Server slowness shows in the round trip, client stalls in the
+// age of the last byte received.
+void    QNetsoul::showPingLatency(qint64 rtt)
+{
+  const LatencyHistogram& latency = this->_network->pingLatency();
+  this->statusbar->setToolTip
+    (tr("Ping %1 ms (p50 %2 ms, p99 %3 ms), last received %4 ms ago")
+     .arg(rtt / 1000.0, 0, 'f', 1)
+     .arg(latency.percentile(50) / 1000.0, 0, 'f', 1)
+     .arg(latency.percentile(99) / 1000.0, 0, 'f', 1)
+     .arg(this->_network->inboundAge()));
+}
+
+void    QNetsoul::showNetworkStatistics(void)
+{
+  const QByteArray json =
+    QJsonDocument(this->_network->statistics()).toJson();
+  const LatencyHistogram& latency = this->_network->pingLatency();
+  QMessageBox box(QMessageBox::Information, tr("Network statistics"),
+                  tr("Pings answered: %1\n"
+                     "Round trip: last %2 ms, p50 %3 ms, p99 %4 ms, "
+                     "max %5 ms\n"
+                     "Last received: %6 ms ago\n"
+                     "Queued commands: %7\n"
+                     "Typing notifications: %8 sent, %9 suppressed")
+                  .arg(latency.count())
+                  .arg(latency.last() / 1000.0, 0, 'f', 1)
+                  .arg(latency.percentile(50) / 1000.0, 0, 'f', 1)
+                  .arg(latency.percentile(99) / 1000.0, 0, 'f', 1)
+                  .arg(latency.max() / 1000.0, 0, 'f', 1)
+                  .arg(this->_network->inboundAge())
+                  .arg(this->_network->queueDepth())
+                  .arg(this->_network->typingShaper().sent())
+                  .arg(this->_network->typingShaper().suppressed()),
+                  QMessageBox::Close, this);
+  box.setDetailedText(QString::fromUtf8(json));
+  QPushButton* save = box.addButton(tr("Save JSON..."),
+                                    QMessageBox::ActionRole);
+  box.exec();
+  if (box.clickedButton() != save)
+    return;
+  const QString fileName =
+    QFileDialog::getSaveFileName(this, tr("Save statistics"),
+                                 "qnetsoul-statistics.json",
+                                 tr("JSON (*.json)"));
+  if (fileName.isEmpty())
+    return;
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+      file.write(json) != json.size())
+    QMessageBox::warning(this, tr("Network statistics"),
+                         tr("Cannot write %1: %2")
+                         .arg(fileName, file.errorString()));
+}
+
 void    QNetsoul::notifyTypingStatus(const int id, const bool typing)
 {
   Chat* chat = getChat(id);
@@ -516,6 +682,36 @@ void    QNetsoul::setPortrait(const QString& login)
   this->tree->setPortrait(login, portraitPath);
 }
 
+// The message goes in the chat of every connection point of the
+// recipients, hidden ones included; none is opened. It is also kept in
+// each recipient's transcript, for the chats created later.
+void    QNetsoul::recordGroupMessage(const QStringList& logins,
+                                     const QString& message,
+                                     const qint64 id)
+{
+  const QString self = this->_options->loginLineEdit->text();
+  GroupMessage sent;
+  sent.text = message;
+  sent.id = id;
+  sent.network = this->_network; // the tree sends through it
+  sent.sent = QDateTime::currentDateTime();
+  for (int j = 0; j < logins.size(); ++j)
+    {
+      QList<GroupMessage>& transcript = this->_groupTranscripts[logins.at(j)];
+      transcript.append(sent);
+      if (transcript.size() > GroupTranscriptSize)
+        transcript.removeFirst();
+    }
+  QHashIterator<int, Chat*> i(this->_windowsChat);
+  while (i.hasNext())
+    {
+      i.next();
+      if (logins.contains(i.value()->login()))
+        i.value()->insertMessage(self, message, QColor(32, 74, 135), id,
+                                 sent.network);
+    }
+}
+
 void    QNetsoul::aboutQNetSoul(void)
 {
   QMessageBox::about(this, "QNetSoul", this->whatsThis());
@@ -557,6 +753,55 @@ void    QNetsoul::readSettings(void)
   resize(settings.value("size", QSize(280, 584)).toSize());
   move(settings.value("pos", QPoint(501, 232)).toPoint());
   settings.endGroup();
+
+  // Additional accounts, logged in along the main one
+  const int size = settings.beginReadArray("Sessions");
+  for (int i = 0; i < size; ++i)
+    {
+      SessionOptions options;
+      settings.setArrayIndex(i);
+      options.server = settings.value("ip", options.server).toString();
+      options.port = settings.value("port", options.port).toUInt();
+      options.login = settings.value("login").toString();
+      options.password =
+        Tools::unencrypt(settings.value("password").toString());
+      options.location =
+        settings.value("location", options.location).toString();
+      options.comment = settings.value("comment").toString();
+      if (!options.login.isEmpty() && !options.password.isEmpty())
+        addSession(options);
+    }
+  settings.endArray();
+}
+
+// Extra sessions share the tree, the chats and the portraits with the
+// main one, they only bring their socket and login.
+void    QNetsoul::addSession(const SessionOptions& options)
+{
+  Network* session = new Network(this);
+  session->setSessionOptions(options);
+  connect(session, SIGNAL(statusMessage(const QString&, int)),
+          SLOT(showSessionMessage(const QString&, int)));
+  connect(session, SIGNAL(msg(const NetsoulEvent&, const QString&)),
+          SLOT(showConversation(const NetsoulEvent&, const QString&)));
+  connect(session, SIGNAL(state(const NetsoulEvent&)),
+          SLOT(changeStatus(const NetsoulEvent&)));
+  connect(session, SIGNAL(who(const NetsoulEvent&)),
+          SLOT(updateContact(const NetsoulEvent&)));
+  connect(session, SIGNAL(typingStatus(const int, bool)),
+          SLOT(notifyTypingStatus(const int, bool)));
+  connect(statusComboBox, SIGNAL(currentIndexChanged(int)),
+          session, SLOT(sendStatus(const int&)));
+  this->_sessions.append(session);
+}
+
+void    QNetsoul::showSessionMessage(const QString& message, int timeout)
+{
+  const Network* session = qobject_cast<Network*>(sender());
+  if (session)
+    this->statusbar->showMessage(QString("[%1] %2")
+                                 .arg(session->sessionOptions().login)
+                                 .arg(message), timeout);
 }
 
 void    QNetsoul::writeSettings(void)
@@ -584,18 +829,22 @@ void    QNetsoul::setupTrayIcon(void)
 
 void    QNetsoul::connectQNetsoulModules(void)
 {
-  connect(this->_ping, SIGNAL(timeout()), this, SLOT(ping()));
   connect(this->_internUpdater, SIGNAL(quitApplication()),
-          this, SLOT(saveStateBeforeQuiting()));
+          this, SLOT(quitForUpdate()));
   connect(this->_portraitResolver,
           SIGNAL(downloadedPortrait(const QString&)),
           SLOT(setPortrait(const QString&)));
-  connect(this->tree, SIGNAL(openConversation(const QStringList&)),
-          this, SLOT(showConversation(const QStringList&)));
+  connect(this->tree, SIGNAL(openConversation(const NetsoulEvent&)),
+          this, SLOT(showConversation(const NetsoulEvent&)));
   connect(this->tree, SIGNAL(downloadPortrait(const QString&, bool)),
           this->_portraitResolver, SLOT(addRequest(const QString&, bool)));
   connect(this->tree, SIGNAL(contactRemoved(const QString&)),
           SLOT(disableChats(const QString&)));
+  connect(this->tree,
+          SIGNAL(groupMessageSent(const QStringList&, const QString&,
+                                  qint64)),
+          SLOT(recordGroupMessage(const QStringList&, const QString&,
+                                  qint64)));
 }
 
 void    QNetsoul::connectActionsSignals(void)
@@ -629,6 +878,8 @@ void    QNetsoul::connectActionsSignals(void)
   // Help
   connect(actionAbout_QNetSoul, SIGNAL(triggered()), SLOT(aboutQNetSoul()));
   connect(actionAbout_Qt, SIGNAL(triggered()), qApp, SLOT(aboutQt()));
+  connect(actionNetworkStatistics, SIGNAL(triggered()),
+          SLOT(showNetworkStatistics()));
   // Status
   connect(statusComboBox, SIGNAL(currentIndexChanged(int)),
           this->_network, SLOT(sendStatus(const int&)));
@@ -639,30 +890,52 @@ void    QNetsoul::connectActionsSignals(void)
 
 void    QNetsoul::connectNetworkSignals(void)
 {
+  connect(this->_network, SIGNAL(statusMessage(const QString&, int)),
+          this->statusbar, SLOT(showMessage(const QString&, int)));
+  connect(this->_network,
+          SIGNAL(stateChanged(const QAbstractSocket::SocketState&)),
+          SLOT(updateWidgets(const QAbstractSocket::SocketState&)));
+  connect(this->_network, SIGNAL(reconnecting()),
+          SLOT(prepareReconnection()));
+  connect(this->_network, SIGNAL(reconnectionAbandoned()),
+          SLOT(abandonReconnection()));
   connect(this->_network, SIGNAL(handShaking(int, QStringList)),
           SLOT(processHandShaking(int, QStringList)));
-  connect(this->_network, SIGNAL(msg(const QStringList&, const QString&)),
-          SLOT(showConversation(const QStringList&, const QString&)));
-  connect(this->_network, SIGNAL(state(const QStringList&)),
-          SLOT(changeStatus(const QStringList&)));
-  connect(this->_network, SIGNAL(who(const QStringList&)),
-          SLOT(updateContact(const QStringList&)));
+  connect(this->_network, SIGNAL(msg(const NetsoulEvent&, const QString&)),
+          SLOT(showConversation(const NetsoulEvent&, const QString&)));
+  connect(this->_network, SIGNAL(state(const NetsoulEvent&)),
+          SLOT(changeStatus(const NetsoulEvent&)));
+  connect(this->_network, SIGNAL(who(const NetsoulEvent&)),
+          SLOT(updateContact(const NetsoulEvent&)));
+  connect(this->_network, SIGNAL(loginPhaseReached(int, qint64)),
+          SLOT(showLoginPhase(int, qint64)));
+  connect(this->_network, SIGNAL(pingAnswered(qint64)),
+          SLOT(showPingLatency(qint64)));
+  connect(this->_network, SIGNAL(sweepFinished(int, int, qint64)),
+          this->tree, SLOT(removeStaleConnectionPoints()));
   connect(this->_network, SIGNAL(typingStatus(const int, bool)),
           SLOT(notifyTypingStatus(const int, bool)));
 }
 
 Chat*   QNetsoul::createWindowChat(const int id,
                                    const QString& login,
-                                   const QString& location)
+                                   const QString& location,
+                                   Network* session)
 {
   Chat* chat = new Chat(id, login, location);
   chat->setOptions(this->_options);
-  chat->setNetwork(this->_network);
+  chat->setNetwork(session ? session : this->_network);
   // Binding shortcuts
   chat->addAction(this->actionVDM);
   chat->addAction(this->actionCNF);
   chat->addAction(this->actionPastebin);
   chat->addAction(this->actionPreferences);
+  const QList<GroupMessage> transcript = this->_groupTranscripts.value(login);
+  for (int i = 0; i < transcript.size(); ++i)
+    chat->insertMessage(this->_options->loginLineEdit->text(),
+                        transcript.at(i).text, QColor(32, 74, 135),
+                        transcript.at(i).id, transcript.at(i).network,
+                        transcript.at(i).sent);
   this->_windowsChat.insert(id, chat);
   return chat;
 }
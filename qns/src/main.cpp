@@ -16,13 +16,30 @@
 */
 
 #include <QtWidgets>
+#include <QCommandLineParser>
 #include "QNetsoul.h"
 
 int main(int argc, char** argv)
 {
   QApplication  app(argc, argv);
   QNetsoul      netsoul;
+  QCommandLineParser parser;
 
+  parser.addHelpOption();
+  parser.addOptions(QList<QCommandLineOption>()
+                    << QCommandLineOption("capture",
+                                          "Record the inbound stream.",
+                                          "file")
+                    << QCommandLineOption("replay", "Replay a capture.",
+                                          "file")
+                    << QCommandLineOption("speed",
+                                          "Replay speed, 0: as fast as "
+                                          "possible.", "x", "1"));
+  parser.process(app);
+
+  netsoul.setCapture(parser.value("capture"));
   netsoul.show();
+  if (parser.isSet("replay"))
+    netsoul.replay(parser.value("replay"), parser.value("speed").toDouble());
   return app.exec();
 }
@@ -0,0 +1,76 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DAEMON_H_
+#define DAEMON_H_
+
+#include <QTimer>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include "NetsoulEvent.h"
+#include "SessionOptions.h"
+
+class   Network;
+class   PresenceScheduler;
+class   TraceReplayer;
+
+// Headless presence monitor: logs in, watches contacts and prints one
+// line per event on stdout, status messages on stderr.
+class   Daemon : public QObject
+{
+  Q_OBJECT
+
+    public:
+  Daemon(const SessionOptions& options, const QStringList& contacts);
+
+  void  start(void);
+  // Once logged in, sends a bytes long message to our other locations
+  // and reports how long it takes to leave the client
+  void  setPaste(const int bytes) { this->_paste = bytes; }
+  // Prints a capture instead of connecting, then the replay report
+  bool  replay(const QString& path, const double speed);
+
+  private slots:
+  void  processHandShaking(int step, QStringList);
+  void  printWho(const NetsoulEvent& event);
+  void  printState(const NetsoulEvent& event);
+  void  printMsg(const NetsoulEvent& event, const QString& message);
+  void  printTyping(const int id, bool typing);
+  void  printStatus(const QString& message, int);
+  void  finishReplay(void);
+  void  checkPaste(void);
+
+ private:
+  void  print(const char* type, const NetsoulEvent& event,
+              const QString& extra = QString());
+  void  paste(void);
+
+ private:
+  Network*           _network;
+  PresenceScheduler* _presence;
+  TraceReplayer*     _replayer;
+  QStringList        _contacts;
+  QTextStream        _out;
+  QTextStream        _err;
+  int                _paste;
+  QTimer             _pasteTimer;
+  QElapsedTimer      _pasteClock;
+};
+
+#endif // DAEMON_H_
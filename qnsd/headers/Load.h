@@ -0,0 +1,51 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LOAD_H_
+#define LOAD_H_
+
+#include <QTimer>
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+#include "ShardedRuntime.h"
+
+// Load mode: many copies of one session spread over shards of the
+// ShardedRuntime. Prints the merged counters every second on stderr,
+// which is what gets compared when measuring against a local server.
+class   Load : public QObject
+{
+  Q_OBJECT
+
+    public:
+  Load(const SessionOptions& options, const QStringList& contacts,
+       const int sessions, const int shards);
+
+  // duration in seconds, 0 runs until killed.
+  bool  start(const int duration);
+
+  private slots:
+  void  printStats(void);
+  void  finish(void);
+
+ private:
+  ShardedRuntime _runtime;
+  QTimer         _stats;
+  QElapsedTimer  _clock;
+};
+
+#endif // LOAD_H_
@@ -0,0 +1,47 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TOKENIZER_BENCH_H_
+#define TOKENIZER_BENCH_H_
+
+#include <QList>
+#include <QString>
+#include <QByteArray>
+
+// Tokenizer micro-benchmark: times the Tokenizer and Protocol against
+// the QString split/section parsing they replaced, on the lines of a
+// capture or on synthetic who replies. Prints one line per path on
+// stdout: name, lines parsed, nanoseconds per line.
+class   TokenizerBench
+{
+ public:
+  TokenizerBench(void) {}
+
+  // Lines of a capture (Trace.h), false if it cannot be read
+  bool  load(const QString& path);
+  // count who replies shaped like ns-server's
+  void  synthesize(const int count);
+  void  run(const int rounds);
+  QString errorString(void) const { return this->_error; }
+
+ private:
+  QList<QByteArray> _lines;
+  QByteArray        _stream; // the lines, '\n' terminated
+  QString           _error;
+};
+
+#endif // TOKENIZER_BENCH_H_
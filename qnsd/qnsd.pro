@@ -0,0 +1,46 @@
+CONFIG += release console
+CONFIG -= app_bundle
+TEMPLATE = app
+# Headless daemon: QCoreApplication only
+QT = core network
+
+DEPENDPATH += . \
+    headers \
+    src \
+    ../tools \
+    ../libnetsoul/headers \
+    ../libnetsoul/tpl
+
+INCLUDEPATH += . \
+    headers \
+    ../tools \
+    ../libnetsoul/headers \
+    ../libnetsoul/tpl
+
+# Inputs
+HEADERS += headers/Daemon.h \
+    headers/TokenizerBench.h
+
+SOURCES += src/main.cpp \
+    src/Daemon.cpp \
+    src/TokenizerBench.cpp
+
+# epoll load mode, Linux only
+linux {
+    HEADERS += headers/Load.h
+    SOURCES += src/Load.cpp
+}
+
+# Headless core
+LIBS += -L../libnetsoul -lnetsoul
+unix:  PRE_TARGETDEPS += ../libnetsoul/libnetsoul.a
+win32: PRE_TARGETDEPS += ../libnetsoul/netsoul.lib
+
+# Output
+TARGET = qnsd
+OBJECTS_DIR = obj
+MOC_DIR = moc
+
+unix:  DESTDIR = ../
+win32: DESTDIR = ../
+macx:  DESTDIR = .
@@ -0,0 +1,159 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <QCoreApplication>
+#include "Daemon.h"
+#include "Network.h"
+#include "PresenceScheduler.h"
+#include "TraceReplayer.h"
+#include "tools.h"
+
+// Imported from tools.cpp
+extern const State states[];
+
+Daemon::Daemon(const SessionOptions& options, const QStringList& contacts)
+  : _network(new Network(this)), _replayer(NULL), _contacts(contacts),
+    _out(stdout), _err(stderr), _paste(0)
+{
+  this->_presence = new PresenceScheduler(this->_network);
+  this->_network->setSessionOptions(options);
+  connect(this->_network, SIGNAL(handShaking(int, QStringList)),
+          SLOT(processHandShaking(int, QStringList)));
+  connect(this->_network, SIGNAL(who(const NetsoulEvent&)),
+          SLOT(printWho(const NetsoulEvent&)));
+  connect(this->_network, SIGNAL(state(const NetsoulEvent&)),
+          SLOT(printState(const NetsoulEvent&)));
+  connect(this->_network, SIGNAL(msg(const NetsoulEvent&, const QString&)),
+          SLOT(printMsg(const NetsoulEvent&, const QString&)));
+  connect(this->_network, SIGNAL(typingStatus(const int, bool)),
+          SLOT(printTyping(const int, bool)));
+  connect(this->_network, SIGNAL(statusMessage(const QString&, int)),
+          SLOT(printStatus(const QString&, int)));
+  connect(&this->_pasteTimer, SIGNAL(timeout()), SLOT(checkPaste()));
+}
+
+void    Daemon::start(void)
+{
+  this->_network->connect();
+}
+
+bool    Daemon::replay(const QString& path, const double speed)
+{
+  this->_replayer = new TraceReplayer(this->_network, this);
+  connect(this->_replayer, SIGNAL(finished()), SLOT(finishReplay()));
+  if (!this->_replayer->open(path))
+    {
+      this->_err << "qnsd: cannot replay " << path << ": "
+                 << this->_replayer->errorString() << endl;
+      return false;
+    }
+  this->_replayer->start(speed);
+  return true;
+}
+
+void    Daemon::finishReplay(void)
+{
+  this->_out.flush();
+  this->_err << this->_replayer->report() << endl;
+  QCoreApplication::quit();
+}
+
+void    Daemon::processHandShaking(int step, QStringList)
+{
+  switch (step)
+    {
+    case 2:
+      this->_network->monitorContacts(this->_contacts);
+      this->_presence->setContacts(this->_contacts);
+      this->_presence->start();
+      if (this->_paste > 0)
+        paste();
+      break;
+    case -1:
+      QCoreApplication::exit(1);
+      break;
+    default:;
+    }
+}
+
+void    Daemon::paste(void)
+{
+  QString text;
+  text.reserve(this->_paste);
+  for (int line = 1; text.size() < this->_paste; ++line)
+    text += QString("%1 The quick brown fox jumps over the lazy dog.\n")
+      .arg(line, 6);
+  text.truncate(this->_paste);
+
+  const int depth = this->_network->queueDepth();
+  this->_pasteClock.start();
+  this->_network->transmitMsg(this->_network->sessionOptions().login,
+                              QString(), text);
+  this->_err << "paste: " << text.size() << " bytes in "
+             << this->_network->queueDepth() - depth << " lines, queued in "
+             << this->_pasteClock.elapsed() << " ms" << endl;
+  this->_paste = 0;
+  this->_pasteTimer.start(100);
+}
+
+void    Daemon::checkPaste(void)
+{
+  if (this->_network->queueDepth() > 0)
+    return;
+  this->_pasteTimer.stop();
+  const qint64 elapsed = qMax(Q_INT64_C(1), this->_pasteClock.elapsed());
+  this->_err << "paste: written in " << elapsed << " ms" << endl;
+}
+
+void    Daemon::printWho(const NetsoulEvent& event)
+{
+  print("who", event, event.comment);
+}
+
+void    Daemon::printState(const NetsoulEvent& event)
+{
+  print("state", event);
+}
+
+void    Daemon::printMsg(const NetsoulEvent& event, const QString& message)
+{
+  print("msg", event, message);
+}
+
+void    Daemon::printTyping(const int id, bool typing)
+{
+  this->_out << (typing ? "typing " : "typing-cancelled ") << id << endl;
+}
+
+void    Daemon::printStatus(const QString& message, int)
+{
+  this->_err << message << endl;
+}
+
+// type id login state location [extra]
+void    Daemon::print(const char* type, const NetsoulEvent& event,
+                      const QString& extra)
+{
+  this->_out << type << ' ' << event.id << ' ' << event.login << ' '
+             << (NetsoulEvent::Unknown == event.state ?
+                 "unknown" : states[event.state].state)
+             << ' ' << event.location;
+  if (!extra.isEmpty())
+    this->_out << ' ' << extra;
+  this->_out << endl;
+}
@@ -0,0 +1,74 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <QCoreApplication>
+#include "Load.h"
+
+namespace
+{
+  const int STATS_INTERVAL = 1000; // milliseconds
+}
+
+Load::Load(const SessionOptions& options, const QStringList& contacts,
+           const int sessions, const int shards)
+  : _runtime(shards)
+{
+  this->_runtime.setContacts(contacts);
+  for (int i = 0; i < sessions; ++i)
+    this->_runtime.addSession(options);
+  this->_stats.setInterval(STATS_INTERVAL);
+  connect(&this->_stats, SIGNAL(timeout()), SLOT(printStats()));
+}
+
+bool    Load::start(const int duration)
+{
+  if (0 == this->_runtime.sessionCount() || !this->_runtime.start())
+    {
+      fprintf(stderr, "qnsd: cannot start the epoll engine.\n");
+      return false;
+    }
+  this->_clock.start();
+  this->_stats.start();
+  if (duration > 0)
+    QTimer::singleShot(duration * 1000, this, SLOT(finish()));
+  return true;
+}
+
+// One line per interval, cumulative values:
+// elapsed shards sessions connected netsouled failed closed lines
+// events connection-points in out
+void    Load::printStats(void)
+{
+  const EpollEngine::Stats stats = this->_runtime.stats();
+  fprintf(stderr, "%lld %d %d %d %d %d %d %llu %llu %d %llu %llu\n",
+          static_cast<long long>(this->_clock.elapsed()),
+          this->_runtime.shardCount(), this->_runtime.sessionCount(),
+          stats.connected, stats.netsouled, stats.failed, stats.closed,
+          static_cast<unsigned long long>(stats.lines),
+          static_cast<unsigned long long>(this->_runtime.events()),
+          this->_runtime.connectionPoints(),
+          static_cast<unsigned long long>(stats.bytesIn),
+          static_cast<unsigned long long>(stats.bytesOut));
+}
+
+void    Load::finish(void)
+{
+  this->_runtime.stop();
+  printStats();
+  QCoreApplication::quit();
+}
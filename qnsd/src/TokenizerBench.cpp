@@ -0,0 +1,182 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "Url.h"
+#include "Trace.h"
+#include "Protocol.h"
+#include "Tokenizer.h"
+#include "LineBuffer.h"
+#include "TokenizerBench.h"
+
+namespace
+{
+  // The user_cmd parsing of Network::interpretLine before the
+  // Tokenizer: split on spaces, then section() per property.
+  int   legacyInterpret(const QString& line)
+  {
+    QStringList properties;
+    const QStringList parts = line.split(' ', QString::SkipEmptyParts);
+    const int size = parts.size();
+
+    if (!line.startsWith("user_cmd") || size < 4)
+      return size;
+    if ("who" == parts.at(3) && size >= 15)
+      {
+        properties << parts.at(5) // login
+                   << parts.at(4) // id
+                   << parts.at(6) // ip
+                   << parts.at(13) // group
+                   << parts.at(14).section(':', 0, 0) // state
+                   << url_decode(parts.at(12).toStdString().c_str());
+        if (size < 16)
+          properties << "";
+        else
+          properties << url_decode(parts.at(15).toStdString().c_str());
+      }
+    else if (("state" == parts.at(3) && size >= 5) ||
+             "login" == parts.at(3) || "logout" == parts.at(3) ||
+             ("msg" == parts.at(3) && size >= 5))
+      {
+        properties << parts.at(1).section(':', 3, 3).section('@', 0, 0)
+                   << parts.at(1).section(':', 0, 0) // id
+                   << parts.at(1).section(':', 3, 3).section('@', -1)
+                   << parts.at(1).section(':', -1) // group
+                   << parts.at(size >= 5 ? 4 : 3).section(':', 0, 0)
+                   << url_decode(parts.at(1).section(':', -2, -2)
+                                 .toStdString().c_str()); // location
+      }
+    return size + properties.size();
+  }
+
+  void  report(const char* name, const quint64 lines, const qint64 nsecs,
+               const quint64 sink)
+  {
+    fprintf(stdout, "%s %llu %.1f (%llu)\n", name,
+            static_cast<unsigned long long>(lines),
+            lines ? static_cast<double>(nsecs) / lines : 0.0,
+            static_cast<unsigned long long>(sink));
+  }
+}
+
+bool    TokenizerBench::load(const QString& path)
+{
+  TraceReader reader;
+  QList<TraceReader::Chunk> chunks;
+  if (!reader.read(path, chunks))
+    {
+      this->_error = reader.errorString();
+      return false;
+    }
+  LineBuffer buffer;
+  QByteArray line;
+  for (int i = 0; i < chunks.size(); ++i)
+    {
+      buffer.append(chunks.at(i).data.constData(), chunks.at(i).data.size());
+      while (buffer.nextLine(line))
+        if (!line.isEmpty())
+          {
+            this->_lines.append(QByteArray(line.constData(), line.size()));
+            this->_stream.append(line).append('\n');
+          }
+      buffer.compact();
+    }
+  return true;
+}
+
+// user_cmd 199:user:1/3:dally_r@0.0.0.0:~:maison:epitech_2011
+// | who 329 sundas_c 0.0.0.0 1281146904 1281147024 3 1 ~ maison
+// epitech_2011 actif:1281147031 qnetsoul
+void    TokenizerBench::synthesize(const int count)
+{
+  static const char* states[] = { "actif", "away", "lock", "idle" };
+  const QByteArray requester =
+    "user_cmd 199:user:1/3:dally_r@10.224.0.1:~:maison:epitech_2011";
+
+  for (int i = 0; i < count; ++i)
+    {
+      const QByteArray id = QByteArray::number(300 + i);
+      const QByteArray login = "user_" + QByteArray::number(i % 1000);
+      const QByteArray ip = "10.224." + QByteArray::number(i % 250) + '.'
+        + QByteArray::number(i % 200 + 1);
+      const QByteArray line = requester + " | who " + id + ' ' + login + ' '
+        + ip + " 1281146904 1281147024 3 1 ~ sm-" + QByteArray::number(i % 30)
+        + "%20salle%20" + QByteArray::number(i % 12) + " epitech_2015 "
+        + states[i % 4] + ":1281147031 QNetSoul%201.0";
+      this->_lines.append(line);
+      this->_stream.append(line).append('\n');
+    }
+}
+
+// Each path parses every line rounds times; the sink keeps the compiler
+// from dropping the work.
+void    TokenizerBench::run(const int rounds)
+{
+  QElapsedTimer clock;
+  const quint64 lines = static_cast<quint64>(this->_lines.size()) * rounds;
+  quint64 sink = 0;
+
+  fprintf(stdout, "# %d lines, %d rounds, tokenizer: %s\n",
+          this->_lines.size(), rounds, Tokenizer::implementation());
+
+  clock.start();
+  for (int r = 0; r < rounds; ++r)
+    for (int i = 0; i < this->_lines.size(); ++i)
+      sink += QString::fromUtf8(this->_lines.at(i))
+        .split(' ', QString::SkipEmptyParts).size();
+  report("split", lines, clock.nsecsElapsed(), sink);
+
+  Tokenizer tokenizer;
+  sink = 0;
+  clock.start();
+  for (int r = 0; r < rounds; ++r)
+    for (int i = 0; i < this->_lines.size(); ++i)
+      sink += tokenizer.tokenize(this->_lines.at(i));
+  report("tokenizer", lines, clock.nsecsElapsed(), sink);
+
+  // Framing, splitting and field extraction, as the old
+  // Network::readFromSocket and interpretLine did them
+  sink = 0;
+  clock.start();
+  for (int r = 0; r < rounds; ++r)
+    {
+      const QStringList received = QString::fromUtf8(this->_stream)
+        .split('\n', QString::SkipEmptyParts);
+      for (int i = 0; i < received.size(); ++i)
+        sink += legacyInterpret(received.at(i));
+    }
+  report("split-section", lines, clock.nsecsElapsed(), sink);
+
+  Protocol protocol;
+  protocol.resume();
+  QList<NetsoulEvent> events;
+  QByteArray replies;
+  sink = 0;
+  clock.start();
+  for (int r = 0; r < rounds; ++r)
+    {
+      protocol.buffer().append(this->_stream.constData(),
+                               this->_stream.size());
+      protocol.parseLines(events, replies);
+      sink += events.size();
+      events.clear();
+      replies.clear();
+    }
+  report("protocol", lines, clock.nsecsElapsed(), sink);
+}
@@ -0,0 +1,181 @@
+/*
+  Copyright 2010 Dally Richard
+  This file is part of QNetSoul.
+  QNetSoul is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  QNetSoul is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with QNetSoul.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QFile>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include "Daemon.h"
+#include "ContactsFile.h"
+#include "TokenizerBench.h"
+#ifdef Q_OS_LINUX
+# include <QThread>
+# include "Load.h"
+#endif
+
+int     main(int argc, char** argv)
+{
+  QCoreApplication      app(argc, argv);
+  QCommandLineParser    parser;
+  SessionOptions        options;
+
+  app.setApplicationName("qnsd");
+  parser.setApplicationDescription("Headless NetSoul presence monitor.");
+  parser.addHelpOption();
+  parser.addOptions(QList<QCommandLineOption>()
+                    << QCommandLineOption("server", "NetSoul server.",
+                                          "host", options.server)
+                    << QCommandLineOption("port", "NetSoul port.",
+                                          "port", QString::number(options.port))
+                    << QCommandLineOption("login", "Account login.", "login")
+                    << QCommandLineOption("location", "Location, %L resolves.",
+                                          "location", options.location)
+                    << QCommandLineOption("comment", "Comment.", "comment")
+                    << QCommandLineOption("contacts", "contacts.qns file.",
+                                          "file")
+                    << QCommandLineOption("fallback",
+                                          "Other server, repeatable.",
+                                          "host:port")
+                    << QCommandLineOption("ping-interval",
+                                          "Milliseconds between pings.", "ms",
+                                          QString::number(options.pingInterval))
+                    << QCommandLineOption("ping-deadline",
+                                          "Milliseconds before an unanswered "
+                                          "server is left, 0: never.", "ms",
+                                          QString::number(options.pingDeadline))
+                    << QCommandLineOption("flood-rate",
+                                          "Bytes per second of non-critical "
+                                          "commands.", "bytes",
+                                          QString::number(options.floodRate))
+                    << QCommandLineOption("flood-burst",
+                                          "Bytes of non-critical commands "
+                                          "sent at once.", "bytes",
+                                          QString::number(options.floodBurst))
+                    << QCommandLineOption("capture",
+                                          "Record the inbound stream.", "file")
+                    << QCommandLineOption("outbox",
+                                          "Journal of unsent messages.",
+                                          "file")
+                    << QCommandLineOption("replay",
+                                          "Print a capture instead of "
+                                          "connecting.", "file")
+                    << QCommandLineOption("speed",
+                                          "Replay speed, 0: as fast as "
+                                          "possible.", "x", "1")
+                    << QCommandLineOption("paste",
+                                          "Send a message of n bytes to our "
+                                          "other locations.", "n")
+                    << QCommandLineOption("tokenizer-bench",
+                                          "Time the line parsers over n "
+                                          "rounds of the --replay capture, "
+                                          "or of synthetic who replies.", "n")
+                    << QCommandLineOption("who-lines",
+                                          "Synthetic who replies of "
+                                          "--tokenizer-bench.", "n",
+                                          "10000"));
+#ifdef Q_OS_LINUX
+  parser.addOptions(QList<QCommandLineOption>()
+                    << QCommandLineOption("sessions",
+                                          "Load mode: open n sessions.", "n")
+                    << QCommandLineOption("shards",
+                                          "Load mode: threads, default one "
+                                          "per core.", "k")
+                    << QCommandLineOption("duration",
+                                          "Load mode: stop after s seconds.",
+                                          "s", "0"));
+#endif
+  parser.addPositionalArgument("logins", "Contacts to monitor.",
+                               "[login...]");
+  parser.process(app);
+
+  options.server = parser.value("server");
+  options.port = parser.value("port").toUShort();
+  options.login = parser.value("login");
+  options.location = parser.value("location");
+  options.comment = parser.value("comment");
+  options.capture = parser.value("capture");
+  options.outbox = parser.value("outbox");
+  options.fallbacks = parser.values("fallback");
+  options.pingInterval = qMax(100, parser.value("ping-interval").toInt());
+  options.pingDeadline = qMax(0, parser.value("ping-deadline").toInt());
+  options.floodRate = qMax(1, parser.value("flood-rate").toInt());
+  options.floodBurst = qMax(1, parser.value("flood-burst").toInt());
+  // Kept out of the command line, where ps would show it
+  options.password = QString::fromLocal8Bit(qgetenv("QNSD_PASSWORD"));
+  if (parser.isSet("tokenizer-bench"))
+    {
+      TokenizerBench bench;
+      if (!parser.isSet("replay"))
+        bench.synthesize(qMax(1, parser.value("who-lines").toInt()));
+      else if (!bench.load(parser.value("replay")))
+        {
+          qCritical("qnsd: %s", qPrintable(bench.errorString()));
+          return 1;
+        }
+      bench.run(qMax(1, parser.value("tokenizer-bench").toInt()));
+      return 0;
+    }
+  if (!parser.isSet("replay") &&
+      (options.login.isEmpty() || options.password.isEmpty()))
+    {
+      qCritical("qnsd: --login and QNSD_PASSWORD are required.");
+      return 2;
+    }
+
+  QStringList contacts = parser.positionalArguments();
+  if (parser.isSet("contacts"))
+    {
+      QFile file(parser.value("contacts"));
+      ContactsFile contactsFile;
+      if (!file.open(QIODevice::ReadOnly) || !contactsFile.read(&file))
+        {
+          qCritical("qnsd: cannot read %s: %s",
+                    qPrintable(file.fileName()),
+                    qPrintable(file.isOpen() ?
+                               contactsFile.errorString() :
+                               file.errorString()));
+          return 2;
+        }
+      contacts << contactsFile.logins();
+    }
+  contacts.removeDuplicates();
+
+#ifdef Q_OS_LINUX
+  if (parser.isSet("sessions"))
+    {
+      const int shards = parser.isSet("shards") ?
+        parser.value("shards").toInt() : QThread::idealThreadCount();
+      Load load(options, contacts, parser.value("sessions").toInt(), shards);
+      if (!load.start(parser.value("duration").toInt()))
+        return 1;
+      return app.exec();
+    }
+#endif
+
+  Daemon daemon(options, contacts);
+  if (parser.isSet("replay"))
+    {
+      if (!daemon.replay(parser.value("replay"),
+                         parser.value("speed").toDouble()))
+        return 1;
+    }
+  else
+    {
+      daemon.setPaste(parser.value("paste").toInt());
+      daemon.start();
+    }
+  return app.exec();
+}